@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	#include <intrin.h>
+#endif
+
+namespace benchmark
+	{
+	struct result
+		{
+		std::string name;
+		double ns_per_op;
+		double gb_per_s; //0 when the benchmark doesn't move bytes
+		};
+
+	// Results of every benchmark run so far, in order.
+	inline std::vector<result>& results() { static std::vector<result> instance; return instance; }
+
+	// Only benchmarks which name contains this are run.
+	inline std::string& filter() { static std::string instance; return instance; }
+
+	// Keeps the compiler from optimizing away the computation of value.
+	template <typename T>
+	inline void do_not_optimize(const T& value) noexcept
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+		static const volatile void* sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+		}
+
+	// Calls function repeatedly and records the fastest run. function performs `operations` operations moving `bytes` bytes in total.
+	// Setup runs before each repetition and is not timed.
+	template <typename Setup, typename Function>
+	void run(const std::string& name, size_t operations, size_t bytes, Setup setup, Function function)
+		{
+		if (name.find(filter()) == std::string::npos) { return; }
+
+		using clock = std::chrono::steady_clock;
+		constexpr auto min_total{std::chrono::milliseconds{200}};
+		constexpr size_t min_repetitions{3};
+
+		clock::duration best{clock::duration::max()};
+		clock::duration total{0};
+		for (size_t repetition = 0; repetition < min_repetitions || total < min_total; repetition++)
+			{
+			setup();
+			const auto begin{clock::now()};
+			function();
+			const auto elapsed{clock::now() - begin};
+
+			best = std::min(best, elapsed);
+			total += elapsed;
+			}
+
+		const double ns{std::chrono::duration<double, std::nano>{best}.count()};
+		results().push_back({name, ns / operations, bytes ? bytes / ns : 0});
+		}
+
+	template <typename Function>
+	void run(const std::string& name, size_t operations, size_t bytes, Function function) { run(name, operations, bytes, [] {}, function); }
+
+	void buffer();
+	void tracking();
+	}
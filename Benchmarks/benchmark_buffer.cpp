@@ -0,0 +1,65 @@
+#include <array>
+#include <string>
+#include <optional>
+
+#include <utils/containers/buffer.h>
+
+#include "benchmark.h"
+
+namespace
+	{
+	using big_endian_buffer = utils::container::basic_buffer<std::endian::big>;
+
+	// Times pushing count copies of value into an empty Buffer, then getting them back out of a full one.
+	template <typename Buffer, typename T>
+	void push_get(const std::string& buffer_name, const std::string& value_name, const T& value, size_t count)
+		{
+		Buffer measure;
+		measure.push(value);
+		const size_t bytes{measure.size() * count};
+
+		const std::string name{buffer_name + " " + value_name + " x" + std::to_string(count)};
+		std::optional<Buffer> buffer;
+
+		benchmark::run(name + " push", count, bytes,
+			[&] { buffer.emplace(); },
+			[&]
+				{
+				for (size_t i = 0; i < count; i++) { buffer->push(value); }
+				benchmark::do_not_optimize(*buffer);
+				});
+
+		benchmark::run(name + " get", count, bytes,
+			[&] { buffer.emplace(); for (size_t i = 0; i < count; i++) { buffer->push(value); } },
+			[&]
+				{
+				for (size_t i = 0; i < count; i++) { benchmark::do_not_optimize(buffer->template get<T>()); }
+				});
+		}
+
+	template <typename Buffer>
+	void buffer_mode(const std::string& buffer_name)
+		{
+		for (size_t count : {1'000, 100'000})
+			{
+			push_get<Buffer>(buffer_name, "uint32",     uint32_t{0x01020304}, count);
+			push_get<Buffer>(buffer_name, "double",     1.5, count);
+			push_get<Buffer>(buffer_name, "string16",   std::string(16, 'x'), count);
+			push_get<Buffer>(buffer_name, "float[4]",   std::array<float, 4>{}, count);
+			}
+		for (size_t count : {100, 10'000})
+			{
+			push_get<Buffer>(buffer_name, "string4096", std::string(4096, 'x'), count);
+			push_get<Buffer>(buffer_name, "float[1024]", std::array<float, 1024>{}, count);
+			}
+		}
+	}
+
+void benchmark::buffer()
+	{
+	buffer_mode<utils::container::buffer              >("buffer<deque>");
+	buffer_mode<utils::container::little_endian_buffer>("buffer<little>");
+	buffer_mode<big_endian_buffer                     >("buffer<big>");
+	buffer_mode<utils::container::checked_buffer      >("buffer<crc32c>");
+	buffer_mode<utils::container::segmented_buffer    >("buffer<chunked>");
+	}
@@ -0,0 +1,197 @@
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <optional>
+#include <algorithm>
+
+#include <utils/tracking.h>
+#include <utils/containers/slot_map.h>
+#include <utils/containers/tracked_vector.h>
+
+#include "benchmark.h"
+
+// Only meaningful in release builds, tracking_ptr checks every dereference in debug.
+
+namespace
+	{
+	struct payload
+		{
+		int64_t value;
+		int64_t data[3]{};
+		};
+
+	template <typename Policy>
+	struct trackable_payload : utils::basic_trackable<Policy>
+		{
+		trackable_payload(int64_t value) : value{value} {}
+		int64_t value;
+		int64_t data[3]{};
+		};
+
+	// Each scheme defines how elements are stored, how references to them are taken and how references are followed.
+	// Schemes with relocatable elements also measure moving every element into another vector.
+	struct raw_pointer
+		{
+		using container = std::vector<payload>;
+		using reference = payload*;
+		inline static constexpr bool relocatable{true};
+		static void emplace(container& elements, int64_t value) { elements.push_back({value}); }
+		static reference make_reference(container& elements, size_t index) { return &elements[index]; }
+		static int64_t get(const container&, const reference& ref) { return ref->value; }
+		};
+
+	struct index_handle
+		{
+		using container = std::vector<payload>;
+		using reference = size_t;
+		inline static constexpr bool relocatable{false}; //same as raw_pointer
+		static void emplace(container& elements, int64_t value) { elements.push_back({value}); }
+		static reference make_reference(container&, size_t index) { return index; }
+		static int64_t get(const container& elements, const reference& ref) { return elements[ref].value; }
+		};
+
+	struct shared_pointer
+		{
+		using container = std::vector<std::shared_ptr<payload>>;
+		using reference = std::shared_ptr<payload>;
+		inline static constexpr bool relocatable{true};
+		static void emplace(container& elements, int64_t value) { elements.push_back(std::make_shared<payload>(value)); }
+		static reference make_reference(container& elements, size_t index) { return elements[index]; }
+		static int64_t get(const container&, const reference& ref) { return ref->value; }
+		};
+
+	struct weak_pointer
+		{
+		using container = std::vector<std::shared_ptr<payload>>;
+		using reference = std::weak_ptr<payload>;
+		inline static constexpr bool relocatable{false}; //same as shared_pointer
+		static void emplace(container& elements, int64_t value) { elements.push_back(std::make_shared<payload>(value)); }
+		static reference make_reference(container& elements, size_t index) { return elements[index]; }
+		static int64_t get(const container&, const reference& ref) { return ref.lock()->value; }
+		};
+
+	template <typename Policy>
+	struct tracking_pointer
+		{
+		using container = std::vector<trackable_payload<Policy>>;
+		using reference = utils::tracking_ptr<trackable_payload<Policy>>;
+		inline static constexpr bool relocatable{true};
+		static void emplace(container& elements, int64_t value) { elements.emplace_back(value); }
+		static reference make_reference(container& elements, size_t index) { return elements[index]; }
+		static int64_t get(const container&, const reference& ref) { return ref->value; }
+		};
+
+	template <typename Policy>
+	struct tracked_vector_pointer
+		{
+		using container = utils::container::tracked_vector<payload, Policy>;
+		using reference = utils::tracking_ptr<payload, Policy>;
+		inline static constexpr bool relocatable{false};
+		static void emplace(container& elements, int64_t value) { elements.push_back({value}); }
+		static reference make_reference(container& elements, size_t index) { return elements.track(index); }
+		static int64_t get(const container&, const reference& ref) { return ref->value; }
+		};
+
+	struct slot_map_handle
+		{
+		using container = utils::container::slot_map<payload>;
+		using reference = container::handle;
+		inline static constexpr bool relocatable{false};
+		static void emplace(container& elements, int64_t value) { elements.insert({value}); }
+		static reference make_reference(container& elements, size_t index) { return elements.handle_of(elements.begin() + index); }
+		static int64_t get(const container& elements, const reference& ref) { return elements[ref].value; }
+		};
+
+	template <typename Scheme>
+	void scheme(const std::string& scheme_name)
+		{
+		using container = typename Scheme::container;
+		using reference = typename Scheme::reference;
+
+		for (size_t count : {1'000, 100'000, 10'000'000})
+			{
+			const std::string name{scheme_name + " x" + std::to_string(count)};
+			//Building 10M elements takes a while, skip it when filtered out
+			const auto selected{[&](const char* operation) { return (name + " " + operation).find(benchmark::filter()) != std::string::npos; }};
+			if (!selected("dereference") && !selected("copy") && !selected("growth") && !selected("move")) { continue; }
+
+			container elements;
+			for (size_t i = 0; i < count; i++) { Scheme::emplace(elements, static_cast<int64_t>(i)); }
+
+			//References held by other objects are usually followed in no particular order
+			std::vector<size_t> order(count);
+			std::iota(order.begin(), order.end(), size_t{0});
+			std::shuffle(order.begin(), order.end(), std::mt19937_64{42});
+
+			std::vector<reference> references;
+			references.reserve(count);
+			for (size_t index : order) { references.push_back(Scheme::make_reference(elements, index)); }
+
+			benchmark::run(name + " dereference", count, 0, [&]
+				{
+				int64_t sum{0};
+				for (const auto& ref : references) { sum += Scheme::get(elements, ref); }
+				benchmark::do_not_optimize(sum);
+				});
+
+				{
+				std::vector<reference> copies;
+				copies.reserve(count);
+				benchmark::run(name + " copy", count, 0,
+					[&] { copies.clear(); },
+					[&]
+						{
+						for (const auto& ref : references) { copies.push_back(ref); }
+						benchmark::do_not_optimize(copies.data());
+						});
+				}
+
+				{
+				std::optional<container> grown;
+				benchmark::run(name + " growth", count, 0,
+					[&] { grown.reset(); grown.emplace(); },
+					[&]
+						{
+						for (size_t i = 0; i < count; i++) { Scheme::emplace(*grown, static_cast<int64_t>(i)); }
+						benchmark::do_not_optimize(*grown);
+						});
+				}
+
+			if constexpr (Scheme::relocatable)
+				{
+				//Moved back untimed, so that every repetition moves live elements
+				container moved;
+				moved.reserve(count);
+				benchmark::run(name + " move", count, 0,
+					[&]
+						{
+						if (moved.empty()) { return; }
+						elements.clear();
+						for (auto& element : moved) { elements.push_back(std::move(element)); }
+						moved.clear();
+						},
+					[&]
+						{
+						for (auto& element : elements) { moved.push_back(std::move(element)); }
+						benchmark::do_not_optimize(moved.data());
+						});
+				}
+			}
+		}
+	}
+
+void benchmark::tracking()
+	{
+	scheme<raw_pointer                                                        >("raw pointer");
+	scheme<index_handle                                                       >("index");
+	scheme<shared_pointer                                                     >("shared_ptr");
+	scheme<weak_pointer                                                       >("weak_ptr");
+	scheme<tracking_pointer<utils::tracking_policy>                           >("tracking_ptr<heap>");
+	scheme<tracking_pointer<utils::pooled_tracking_policy>                    >("tracking_ptr<pooled>");
+	scheme<tracking_pointer<utils::single_threaded_tracking_policy>           >("tracking_ptr<single_threaded>");
+	scheme<tracking_pointer<utils::lazy_tracking_policy>                      >("tracking_ptr<lazy>");
+	scheme<tracked_vector_pointer<utils::single_threaded_tracking_policy>     >("tracked_vector<single_threaded>");
+	scheme<slot_map_handle                                                    >("slot_map handle");
+	}
@@ -0,0 +1,68 @@
+// Runs every benchmark and prints ns/op and GB/s.
+//
+// Usage: Benchmarks [--filter text] [--save file] [--baseline file] [--tolerance percent]
+//   --save      writes the results to file, to be used as a later baseline
+//   --baseline  compares with the results saved in file; exits with 1 if any benchmark got slower by more than the tolerance (default 10%)
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+
+#include "benchmark.h"
+
+int main(int argc, char** argv)
+	{
+	std::string save_path;
+	std::string baseline_path;
+	double tolerance{10};
+
+	for (int i = 1; i + 1 < argc; i += 2)
+		{
+		const std::string option{argv[i]};
+		     if (option == "--filter"   ) { benchmark::filter() = argv[i + 1]; }
+		else if (option == "--save"     ) { save_path = argv[i + 1]; }
+		else if (option == "--baseline" ) { baseline_path = argv[i + 1]; }
+		else if (option == "--tolerance") { tolerance = std::stod(argv[i + 1]); }
+		else { std::cerr << "Unknown option " << option << std::endl; return 2; }
+		}
+
+	benchmark::buffer();
+	benchmark::tracking();
+
+	std::map<std::string, double> baseline;
+	if (!baseline_path.empty())
+		{
+		std::ifstream file{baseline_path};
+		std::string name;
+		double ns_per_op;
+		while (file >> std::quoted(name) >> ns_per_op) { baseline[name] = ns_per_op; }
+		}
+
+	bool regressed{false};
+	std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(14) << "ns/op" << std::setw(10) << "GB/s" << std::setw(12) << "baseline" << '\n';
+	for (const auto& result : benchmark::results())
+		{
+		std::cout << std::left << std::setw(56) << result.name << std::right << std::fixed
+			<< std::setw(14) << std::setprecision(3) << result.ns_per_op
+			<< std::setw(10) << std::setprecision(3) << result.gb_per_s;
+
+		if (auto it{baseline.find(result.name)}; it != baseline.end())
+			{
+			const double change{(result.ns_per_op / it->second - 1) * 100};
+			std::cout << std::setw(11) << std::showpos << std::setprecision(1) << change << '%' << std::noshowpos;
+			if (change > tolerance) { std::cout << " REGRESSION"; regressed = true; }
+			}
+		std::cout << '\n';
+		}
+
+	if (!save_path.empty())
+		{
+		std::ofstream file{save_path};
+		for (const auto& result : benchmark::results()) { file << std::quoted(result.name) << ' ' << std::setprecision(17) << result.ns_per_op << '\n'; }
+		}
+
+	return regressed ? 1 : 0;
+	}
@@ -12,8 +12,11 @@
 #include <ostream>
 #include <algorithm>
 #include <iterator>
+#include <span>
+#include <memory>
+#include <type_traits>
 
-#include "../cout_utilities.h"
+#include <utils/cout_utilities.h>
 
 namespace utils
 	{
@@ -35,6 +38,11 @@ namespace utils
 		using ptr_t = std::unique_ptr<arr_t>;
 
 		public:
+			using value_type = T;
+			using size_type = size_t;
+			using reference = T&;
+			using const_reference = const T&;
+
 			/*class iterator
 				{
 				private:
@@ -90,31 +98,66 @@ namespace utils
 					bool operator==(const iterator& oth) const { return coords == oth.coords; }
 					bool operator!=(const iterator& oth) const { return coords != oth.coords; }
 				};*/
-			class iterator
+			// Walks a pointer through the current chunk, and only looks up the next chunk when reaching the end of the current one.
+			// Chunks never move, so iterators stay valid when elements are added; only end() iterators are invalidated by growth.
+			template <bool is_const>
+			class basic_iterator
 				{
-				private:
-					const listed_array& la;
+				friend class listed_array;
+				template <bool>
+				friend class basic_iterator;
 
 				public:
-					size_t index;
-					iterator(const listed_array& la, size_t index) : la(la), index(index) {}
-					iterator(const iterator& oth) : index(oth.index), la(oth.la) {}
-					iterator(iterator&& oth) : index(oth.index), la(oth.la) {}
-					iterator& operator=(const iterator& oth) { index = oth.index; return *this; }
-					iterator& operator=(iterator&& oth) { index = oth.index; return *this; }
-
-					iterator& operator++() { index++; return *this; }
-					iterator operator++(int) { size_t prev = index++; return { la, prev }; }
-					iterator& operator--() { index--; return *this; }
-					iterator operator--(int) { size_t prev = index--; return { la, prev }; }
-					iterator operator()(const listed_array& la) { return { la, index }; }
-
-					T& operator*() const { return la.get_val(index); }
-					T& operator->() const { return la.get_val(index); }
-					bool operator==(const iterator& oth) const { return index == oth.index; }
-					bool operator!=(const iterator& oth) const { return index != oth.index; }
-					bool operator<(const iterator& oth)  const { return index <  oth.index; }
+					using iterator_category = std::bidirectional_iterator_tag;
+					using value_type        = T;
+					using difference_type   = std::ptrdiff_t;
+					using pointer           = std::conditional_t<is_const, const T*, T*>;
+					using reference         = std::conditional_t<is_const, const T&, T&>;
+
+					basic_iterator() = default;
+					template <bool other_const>
+						requires (is_const && !other_const)
+					basic_iterator(const basic_iterator<other_const>& other) noexcept : current(other.current), chunk_end(other.chunk_end), la(other.la), chunk(other.chunk) {}
+
+					reference operator*()  const noexcept { return *current; }
+					pointer   operator->() const noexcept { return current; }
+
+					// The next chunk is looked up in the owning listed_array, which may have grown since this iterator was made.
+					// Past the last element the iterator stays at the end of its chunk, where end() is.
+					basic_iterator& operator++() noexcept
+						{
+						if (++current == chunk_end && (chunk + 1) * internal_capacity < la->size()) { enter(chunk + 1, 0); }
+						return *this;
+						}
+					basic_iterator& operator--() noexcept
+						{
+						if (current == chunk_end - internal_capacity) { enter(chunk - 1, internal_capacity - 1); }
+						else { current--; }
+						return *this;
+						}
+					basic_iterator operator++(int) noexcept { basic_iterator prev = *this; ++(*this); return prev; }
+					basic_iterator operator--(int) noexcept { basic_iterator prev = *this; --(*this); return prev; }
+
+					bool operator==(const basic_iterator& oth) const noexcept { return current == oth.current; }
+
+				private:
+					pointer current = nullptr;
+					pointer chunk_end = nullptr;
+					const listed_array* la = nullptr;
+					size_t chunk = 0;
+
+					basic_iterator(const listed_array& la, size_t chunk, size_t internal_index) noexcept : la(&la) { enter(chunk, internal_index); }
+
+					void enter(size_t new_chunk, size_t internal_index) noexcept
+						{
+						chunk = new_chunk;
+						pointer first = reinterpret_cast<pointer>(la->arrs[chunk]->data());
+						current = first + internal_index;
+						chunk_end = first + internal_capacity;
+						}
 				};
+			using iterator = basic_iterator<false>;
+			using const_iterator = basic_iterator<true>;
 		private:
 			std::vector<ptr_t> arrs;
 			size_t _size = 0;
@@ -131,6 +174,15 @@ namespace utils
 			__forceinline T& get_val(size_t index) const { return *get_ptr(index); }
 			__forceinline T& get_val(coords_t coords) const { return *get_ptr(coords); }
 
+			// The element at index size() is one past the last element, in the last used chunk rather than at the start of the next one.
+			template <bool is_const>
+			basic_iterator<is_const> make_iterator(size_t index) const
+				{
+				if (arrs.empty()) { return {}; }
+				if (index == size() && size()) { return { *this, get_arr_index(size() - 1), get_internal_index(size() - 1) + 1 }; }
+				return { *this, get_arr_index(index), get_internal_index(index) };
+				}
+
 			void grow_to(size_t target) { while (arrs.size() != target) { grow(); } }
 			void grow()
 				{
@@ -209,10 +261,10 @@ namespace utils
 
 			listed_array& operator=(const listed_array& copy) //CHANGED
 				{
+				if (&copy == this) { return *this; }
 				clear();
-				grow_to(copy.arrs.size());
-				for (auto it = copy.begin(); it != copy.end(); it++) { *it(*this) = *it; }
-				_size = copy.size();
+				reserve(copy.size());
+				copy.for_each_chunk([this](std::span<const T> chunk) { for (const T& element : chunk) { push_back(element); } });
 				return *this;
 				}
 
@@ -267,8 +319,37 @@ namespace utils
 				return get_val(index);
 				}
 
-			iterator begin() const { return { *this, 0 }; }
-			iterator end() const { return { *this, size() }; }
+			T& front() const { return get_val(0); }
+			T& back() const { return get_val(size() - 1); }
+
+			iterator begin() { return make_iterator<false>(0); }
+			iterator end() { return make_iterator<false>(size()); }
+			const_iterator begin() const { return make_iterator<true>(0); }
+			const_iterator end() const { return make_iterator<true>(size()); }
+
+			// Calls function with a std::span over the elements of each chunk, in order; loops over a span don't need any chunk lookup.
+			template <typename Function>
+			void for_each_chunk(Function function)
+				{
+				size_t remaining = size();
+				for (size_t i = 0; remaining; i++)
+					{
+					const size_t count = std::min(remaining, internal_capacity);
+					function(std::span<T>(cast_ptr((*arrs[i])[0]), count));
+					remaining -= count;
+					}
+				}
+			template <typename Function>
+			void for_each_chunk(Function function) const
+				{
+				size_t remaining = size();
+				for (size_t i = 0; remaining; i++)
+					{
+					const size_t count = std::min(remaining, internal_capacity);
+					function(std::span<const T>(cast_ptr((*arrs[i])[0]), count));
+					remaining -= count;
+					}
+				}
 			/*iterator begin() const { return { *this, {0, 0} }; }
 			iterator end() const { return { *this, get_coords(size()) }; }*/
 
@@ -296,11 +377,12 @@ namespace utils
 				}*/
 
 			template<typename ... Args>
-			void emplace_back(Args&& ... args)
+			T& emplace_back(Args&& ... args)
 				{
 				if (size() >= capacity()) { grow(); }
-				new (storage_end()) T(std::forward<Args>(args)...);
+				T* element = new (storage_end()) T(std::forward<Args>(args)...);
 				_size++;
+				return *element;
 				}
 
 			/*template<typename ... Args>
@@ -327,6 +409,12 @@ namespace utils
 					}
 				}*/
 
+			void pop_back()
+				{
+				get_ptr(size() - 1)->~T();
+				_size--;
+				}
+
 			void clear() //CHANGED //TOTEST
 				{
 				//TOTEST
@@ -334,7 +422,7 @@ namespace utils
 					{
 					//for (size_t i = 0; i < size(); i++) { get_ptr(i)->~T(); }
 					//for (T& element : *this) { element.~T(); }
-					std::for_each(begin(), end(), [](T& element) { element.~T(); });
+					for_each_chunk([](std::span<T> chunk) { std::destroy(chunk.begin(), chunk.end()); });
 					}
 				arrs.clear();
 				_size = 0;
@@ -1,5 +1,11 @@
 #pragma once
 #include <utils/variadic.h>
+#include <utils/thread_pool.h>
+#include <utils/algorithm/containers.h>
+
+#include <vector>
+#include <memory>
+#include <algorithm>
 
 namespace utils
 	{
@@ -23,12 +29,25 @@ namespace utils
 			template <typename Function>
 			void for_each_container(Function function) { utils::tuple::for_each_in_tuple(containers, [&](auto& container) { function(container); }); }
 			template <typename Function>
-			void for_each_element(Function function) { for_each_container([&](auto& container) { for (auto& element : container) { function(element); } }); }
+			void for_each_element(Function function) { for_each_container([&](auto& container) { for (auto&& element : container) { function(element); } }); }
+
+			// Each container is processed by a different thread; function is called concurrently.
+			template <typename Function>
+			void parallel_for_each_container(utils::thread_pool& threads, Function function)
+				{
+				threads.parallel_for(sizeof...(Types), [&](size_t index) { for_container_at(index, function); });
+				}
+			// Large containers are also split in chunks of chunk_size elements.
+			template <typename Function>
+			void parallel_for_each_element(utils::thread_pool& threads, Function function, size_t chunk_size = utils::default_parallel_chunk_size)
+				{
+				parallel_for_each_container(threads, [&](auto& container) { utils::parallel_for_each(threads, container, function, chunk_size); });
+				}
 
 			template <typename msg_t, typename Function>
 			void for_each_element_of_type(Function function)
 				{
-				for_each_containing_type<msg_t>([&](auto& container) { for (auto& element : container) { function(element); } });
+				for_each_containing_type<msg_t>([&](auto& container) { for (auto&& element : container) { function(element); } });
 				}
 
 			template <typename msg_t, typename Function>
@@ -40,6 +59,29 @@ namespace utils
 					});
 				}
 
+			// Erases the elements matching predicate from every container, see utils::algorithm::unordered_erase_if. Returns the erased count.
+			template <typename Predicate>
+			size_t erase_if(Predicate predicate)
+				{
+				size_t erased = 0;
+				utils::tuple::for_each_in_tuple(containers, [&](auto& container) { erased += utils::algorithm::unordered_erase_if(container, predicate); });
+				return erased;
+				}
+
+			// Deferred erasure: marked elements stay in place, and are still visited, until compact() erases all of them in a single pass.
+			// Marked elements must not be relocated (i.e. by emplacing in their container) before compact().
+			template <typename T>
+			void mark_dead(const T& element) { dead.push_back(address_of(element)); }
+
+			size_t compact()
+				{
+				if (dead.empty()) { return 0; }
+				std::ranges::sort(dead);
+				const size_t erased{erase_if([this](const auto& element) { return std::ranges::binary_search(dead, address_of(element)); })};
+				dead.clear();
+				return erased;
+				}
+
 			size_t size() 
 				{
 				size_t s = 0;
@@ -49,18 +91,27 @@ namespace utils
 
 		private:
 
-			template<typename T, std::size_t index = 0>
-			static constexpr std::size_t get_index_containing_type()
+			template <typename Function>
+			void for_container_at(size_t index, Function& function)
 				{
-				if constexpr (std::is_same_v<T, typename std::tuple_element<index, tuple_t>::type::value_type>) { return index; }
-				else { return get_index_containing_type<T, index + 1>(); }
+				size_t i = 0;
+				utils::tuple::for_each_in_tuple(containers, [&](auto& container) { if (i++ == index) { function(container); } });
 				}
-			template<typename T, std::size_t index = 0>
-			static constexpr std::size_t get_index_containing_type_or_derived()
+
+			std::vector<const void*> dead;
+
+			// Containers whose elements are proxies, like soa_vector, identify the element through address().
+			template <typename T>
+			static const void* address_of(const T& element) noexcept
 				{
-				if constexpr (std::is_base_of<T, typename std::tuple_element<index, tuple_t>::type::value_type>) { return index; }
-				else { return get_index_containing_type_or_derived<T, index + 1>(); }
+				if constexpr (requires { element.address(); }) { return element.address(); }
+				else { return std::addressof(element); }
 				}
+
+			template<typename T>
+			static constexpr std::size_t get_index_containing_type() { return utils::variadic::index_of<T, Types...>; }
+			template<typename T>
+			static constexpr std::size_t get_index_containing_type_or_derived() { return utils::variadic::index_of_derived<T, Types...>; }
 		};
 
 	}
\ No newline at end of file
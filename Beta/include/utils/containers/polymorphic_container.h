@@ -1,94 +1,499 @@
 #pragma once
+#include <memory>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <iterator>
+#include <typeindex>
+#include <unordered_map>
+#include <ranges>
+#include <concepts>
+#include <algorithm>
+#include <functional>
+
 #include "multitype_container.h"
-#include "../polymorphic_value.h"
-#include "../variadic.h"
+#include <utils/polymorphic_value.h>
+#include <utils/variadic.h>
+#include <utils/thread_pool.h>
+#include <utils/algorithm/containers.h>
 
 namespace utils
 	{
+	namespace _
+		{
+		// The ways a container can emplace an element and give back a reference to it, in order of preference.
+		template <typename Container, typename ...Args>
+		concept emplace_back_returns_reference = requires (Container& container, Args&& ...args)
+			{
+			{ container.emplace_back(std::forward<Args>(args)...) } -> std::same_as<typename Container::value_type&>;
+			};
+		template <typename Container, typename ...Args>
+		concept emplace_back_then_back = requires (Container& container, Args&& ...args)
+			{
+			container.emplace_back(std::forward<Args>(args)...);
+			{ container.back() } -> std::same_as<typename Container::value_type&>;
+			};
+		// Unordered pools, i.e. colony-like containers, which return an iterator to wherever they placed the element.
+		template <typename Container, typename ...Args>
+		concept emplace_returns_iterator = requires (Container& container, Args&& ...args)
+			{
+			{ *container.emplace(std::forward<Args>(args)...) } -> std::same_as<typename Container::value_type&>;
+			};
+		// Handle based containers, like utils::container::slot_map. The handle isn't returned by polymorphic_container::emplace, get it back from the element (see slot_map::handle_of).
+		template <typename Container, typename ...Args>
+		concept emplace_returns_handle = requires (Container& container, Args&& ...args)
+			{
+			{ container[container.emplace(std::forward<Args>(args)...)] } -> std::same_as<typename Container::value_type&>;
+			};
+		}
+
+	template <typename Container, typename ...Args>
+	concept emplaceable_container =
+		_::emplace_back_returns_reference<Container, Args...> || _::emplace_back_then_back<Container, Args...> ||
+		_::emplace_returns_iterator      <Container, Args...> || _::emplace_returns_handle<Container, Args...>;
+
+	// How polymorphic_container adds elements to a Container_type; detects what the container supports.
+	// Can be specialized for containers which support none of the emplaceable_container forms.
 	template<template<typename> typename Container_type, typename T>
 	struct container_emplace_helper
-		{};
-
-	template<typename T>
-	struct container_emplace_helper<std::vector, T>
 		{
 		template<typename... Args>
-		static T& emplace(std::vector<T>& v, Args&&... args)
+			requires emplaceable_container<Container_type<T>, Args...>
+		static T& emplace(Container_type<T>& container, Args&&... args)
 			{
-			return v.emplace_back(std::forward<Args>(args)...);
+			using container_t = Container_type<T>;
+			     if constexpr (_::emplace_back_returns_reference<container_t, Args...>) { return container.emplace_back(std::forward<Args>(args)...); }
+			else if constexpr (_::emplace_back_then_back       <container_t, Args...>) { container.emplace_back(std::forward<Args>(args)...); return container.back(); }
+			else if constexpr (_::emplace_returns_iterator     <container_t, Args...>) { return *container.emplace(std::forward<Args>(args)...); }
+			else { return container[container.emplace(std::forward<Args>(args)...)]; }
 			}
 		};
 
+	// How polymorphic_container stores the elements whose type isn't listed in its Types.
+	namespace polymorphic_storage
+		{
+		namespace _
+			{
+			// Remembers, for each type queried through for_each_element_of_type, which of the stored dynamic types derive from it.
+			// Stored types are identified by the order they were first stored in. Each (stored type, queried type) pair costs
+			// a single dynamic_cast, the first time an element of the stored type is available; later queries don't use RTTI.
+			template <typename Base_type>
+			class type_queries
+				{
+				public:
+					struct match
+						{
+						size_t type;
+						std::ptrdiff_t offset; //from the Base_type subobject to the queried type's one
+						};
+
+					// sample(type) returns any element of the given stored type, nullptr if there's none.
+					template <typename msg_t, typename Sample>
+					const std::vector<match>& matches(size_t types_count, Sample sample)
+						{
+						query& q{queries[typeid(msg_t)]};
+						while (q.checked < types_count) { q.pending.push_back(q.checked++); }
+						if (!q.pending.empty())
+							{
+							std::erase_if(q.pending, [&](size_t type)
+								{
+								Base_type* element{sample(type)};
+								if (element == nullptr) { return false; }
+								if (msg_t* cast{dynamic_cast<msg_t*>(element)}) { q.matches.push_back({type, reinterpret_cast<std::byte*>(cast) - reinterpret_cast<std::byte*>(element)}); }
+								return true;
+								});
+							}
+						return q.matches;
+						}
+
+					void clear() noexcept { queries.clear(); }
+
+				private:
+					struct query
+						{
+						size_t checked{0};
+						std::vector<size_t> pending;
+						std::vector<match> matches;
+						};
+					std::unordered_map<std::type_index, query> queries;
+				};
+			}
+
+		// Each element in its own heap allocation, owned by a polymorphic_value.
+		// Elements are also indexed by dynamic type, for for_each_element_of_type; elements added directly to the container returned by get() aren't.
+		template <template<class> class Container_type, typename Base_type>
+		class individual
+			{
+			public:
+				using container_t = Container_type<utils::polymorphic_value<Base_type>>;
+
+				individual() = default;
+				template <typename Arg>
+					requires std::constructible_from<container_t, Arg>
+				individual(Arg&& arg) : container{std::forward<Arg>(arg)} { index_all(); }
+
+				//The index refers to the elements of the copied container.
+				individual(const individual& copy) : container{copy.container} { index_all(); }
+				individual& operator=(const individual& copy) { return *this = individual{copy}; }
+				individual(individual&& move) = default;
+				individual& operator=(individual&& move) = default;
+
+				template <typename msg_t, typename ...Args>
+				msg_t& emplace(Args&& ...args)
+					{
+					std::vector<Base_type*>& bucket{bucket_of(typeid(msg_t))};
+					bucket.push_back(nullptr);
+					try
+						{
+						auto& polyval{container_emplace_helper<Container_type, utils::polymorphic_value<Base_type>>::emplace(container, std::in_place_type<msg_t>, std::forward<Args>(args)...)};
+						bucket.back() = &*polyval;
+						return static_cast<msg_t&>(*polyval);
+						}
+					catch (...) { bucket.pop_back(); throw; }
+					}
+
+				template <typename Function>
+				void for_each_container(Function function) { function(container); }
+				template <typename Function>
+				void for_each_element(Function function) { for (utils::polymorphic_value<Base_type>& polyval : container) { function(*polyval); } }
+				template <typename Function>
+				void parallel_for_each_element(utils::thread_pool& threads, Function function, size_t chunk_size)
+					{
+					utils::parallel_for_each(threads, container, [&](utils::polymorphic_value<Base_type>& polyval) { function(*polyval); }, chunk_size);
+					}
+
+				// Only visits the elements of the matching types.
+				template <typename msg_t, typename Function>
+				void for_each_element_of_type(Function function)
+					{
+					const auto sample{[this](size_t type) { return buckets[type].empty() ? nullptr : buckets[type].front(); }};
+					for (const auto& match : queries.template matches<msg_t>(buckets.size(), sample))
+						{
+						for (Base_type* element : buckets[match.type])
+							{
+							function(*std::launder(reinterpret_cast<msg_t*>(reinterpret_cast<std::byte*>(element) + match.offset)));
+							}
+						}
+					}
+
+				template <typename Predicate>
+				size_t erase_if(Predicate predicate)
+					{
+					std::vector<const Base_type*> erased;
+					erased.reserve(container.size()); //recording erased elements can't fail halfway
+					try
+						{
+						utils::algorithm::unordered_erase_if(container, [&](utils::polymorphic_value<Base_type>& polyval)
+							{
+							if (!predicate(*polyval)) { return false; }
+							erased.push_back(&*polyval);
+							return true;
+							});
+						}
+					catch (...) { unindex(erased); throw; }
+					unindex(erased);
+					return erased.size();
+					}
+
+				container_t& get() noexcept { return container; }
+				size_t size() const { return container.size(); }
+
+			private:
+				container_t container;
+				std::vector<std::vector<Base_type*>> buckets; //elements of each dynamic type; polymorphic_value<Base_type> never stores its object inline, so the addresses are stable
+				std::unordered_map<std::type_index, size_t> bucket_indices;
+				_::type_queries<Base_type> queries;
+
+				std::vector<Base_type*>& bucket_of(std::type_index type)
+					{
+					auto it{bucket_indices.find(type)};
+					if (it != bucket_indices.end()) { return buckets[it->second]; }
+
+					buckets.emplace_back();
+					try { bucket_indices.emplace(type, buckets.size() - 1); }
+					catch (...) { buckets.pop_back(); throw; }
+					return buckets.back();
+					}
+
+				// Removes erased elements from the buckets.
+				void unindex(std::vector<const Base_type*>& erased)
+					{
+					if (erased.empty()) { return; }
+					std::ranges::sort(erased);
+					for (auto& bucket : buckets)
+						{
+						utils::algorithm::unordered_erase_if(bucket, [&](const Base_type* element) { return std::ranges::binary_search(erased, element); });
+						}
+					}
+
+				void index_all()
+					{
+					for (utils::polymorphic_value<Base_type>& polyval : container) { bucket_of(typeid(*polyval)).push_back(&*polyval); }
+					}
+			};
+
+		// Elements grouped by their dynamic type, each type in its own contiguous Container_type (i.e. std::vector).
+		// Pools are created the first time a type is emplaced, so types unknown to the container (i.e. from plugins) are laid out like listed ones.
+		// Iterating walks each pool linearly instead of following one pointer per element.
+		// Like with listed types, emplacing may relocate the other elements of the same type.
+		template <template<class> class Container_type, typename Base_type>
+		class segregated
+			{
+			class pool_base
+				{
+				public:
+					virtual ~pool_base() = default;
+					virtual size_t erase_if(const std::function<bool(Base_type&)>& predicate) = 0;
+
+					// Kept up to date by the derived pool, so that iterating doesn't go through virtual calls.
+					std::byte* data{nullptr};
+					size_t count{0};
+					size_t stride{0};
+					std::ptrdiff_t base_offset{0}; //of the Base_type subobject within an element
+
+					Base_type& operator[](size_t index) const noexcept { return *std::launder(reinterpret_cast<Base_type*>(data + index * stride + base_offset)); }
+				};
+
+			template <typename T>
+			class pool : public pool_base
+				{
+				static_assert(std::ranges::contiguous_range<Container_type<T>>, "segregated polymorphic storage requires a contiguous Container_type.");
+				public:
+					pool() noexcept { this->stride = sizeof(T); }
+
+					size_t erase_if(const std::function<bool(Base_type&)>& predicate) final override
+						{
+						const size_t erased{utils::algorithm::unordered_erase_if(container, [&](T& element) { return predicate(element); })};
+						this->data = reinterpret_cast<std::byte*>(std::ranges::data(container));
+						this->count = std::ranges::size(container);
+						return erased;
+						}
+
+					template <typename ...Args>
+					T& emplace(Args&& ...args)
+						{
+						T& element{container_emplace_helper<Container_type, T>::emplace(container, std::forward<Args>(args)...)};
+						this->data = reinterpret_cast<std::byte*>(std::ranges::data(container));
+						this->count = std::ranges::size(container);
+						this->base_offset = reinterpret_cast<std::byte*>(static_cast<Base_type*>(&element)) - reinterpret_cast<std::byte*>(&element);
+						return element;
+						}
+
+				private:
+					Container_type<T> container;
+				};
+
+			using pools_t = std::vector<std::unique_ptr<pool_base>>;
+
+			public:
+				class iterator
+					{
+					public:
+						using iterator_category = std::forward_iterator_tag;
+						using value_type        = Base_type;
+						using difference_type   = std::ptrdiff_t;
+						using pointer           = Base_type*;
+						using reference         = Base_type&;
+
+						iterator() = default;
+						iterator(typename pools_t::const_iterator pool, typename pools_t::const_iterator pools_end) : pool{pool}, pools_end{pools_end} { skip_empty(); }
+
+						reference operator*()  const noexcept { return (**pool)[index]; }
+						pointer   operator->() const noexcept { return &**this; }
+
+						iterator& operator++() noexcept { index++; skip_empty(); return *this; }
+						iterator operator++(int) noexcept { iterator ret{*this}; ++(*this); return ret; }
+
+						bool operator==(const iterator& other) const noexcept { return pool == other.pool && index == other.index; }
+
+					private:
+						typename pools_t::const_iterator pool;
+						typename pools_t::const_iterator pools_end;
+						size_t index{0};
+
+						void skip_empty() noexcept { while (pool != pools_end && index >= (*pool)->count) { ++pool; index = 0; } }
+					};
+
+				template <typename msg_t, typename ...Args>
+				msg_t& emplace(Args&& ...args) { return pool_of<msg_t>().emplace(std::forward<Args>(args)...); }
+
+				// The storage is passed as a whole, pools are not visible to generic code.
+				template <typename Function>
+				void for_each_container(Function function) { function(*this); }
+				template <typename Function>
+				void for_each_element(Function function)
+					{
+					for (const auto& pool : pools)
+						{
+						for (size_t i = 0; i < pool->count; i++) { function((*pool)[i]); }
+						}
+					}
+				// Pools are processed concurrently, large ones in chunks of chunk_size elements.
+				template <typename Function>
+				void parallel_for_each_element(utils::thread_pool& threads, Function function, size_t chunk_size)
+					{
+					threads.parallel_for(pools.size(), [&](size_t index)
+						{
+						const pool_base& pool{*pools[index]};
+						threads.parallel_for((pool.count + chunk_size - 1) / chunk_size, [&](size_t chunk)
+							{
+							const size_t last{std::min((chunk + 1) * chunk_size, pool.count)};
+							for (size_t i = chunk * chunk_size; i < last; i++) { function(pool[i]); }
+							});
+						});
+					}
+
+				// Only visits the pools of the matching types.
+				template <typename msg_t, typename Function>
+				void for_each_element_of_type(Function function)
+					{
+					const auto sample{[this](size_t type) { return pools[type]->count ? &(*pools[type])[0] : nullptr; }};
+					for (const auto& match : queries.template matches<msg_t>(pools.size(), sample))
+						{
+						const pool_base& pool{*pools[match.type]};
+						const std::ptrdiff_t offset{pool.base_offset + match.offset};
+						for (size_t i = 0; i < pool.count; i++) { function(*std::launder(reinterpret_cast<msg_t*>(pool.data + i * pool.stride + offset))); }
+						}
+					}
+
+				template <typename Predicate>
+				size_t erase_if(Predicate predicate)
+					{
+					size_t erased = 0;
+					for (const auto& pool : pools) { erased += pool->erase_if(predicate); }
+					return erased;
+					}
+
+				segregated& get() noexcept { return *this; }
+				size_t size() const noexcept
+					{
+					size_t s = 0;
+					for (const auto& pool : pools) { s += pool->count; }
+					return s;
+					}
+
+				iterator begin() const noexcept { return {pools.begin(), pools.end()}; }
+				iterator end()   const noexcept { return {pools.end(), pools.end()}; }
+
+			private:
+				pools_t pools;
+				std::unordered_map<std::type_index, pool_base*> pools_by_type;
+				_::type_queries<Base_type> queries;
+
+				template <typename T>
+				pool<T>& pool_of()
+					{
+					auto it{pools_by_type.find(typeid(T))};
+					if (it != pools_by_type.end()) { return static_cast<pool<T>&>(*it->second); }
+
+					pools.push_back(std::make_unique<pool<T>>());
+					try { pools_by_type.emplace(typeid(T), pools.back().get()); }
+					catch (...) { pools.pop_back(); throw; }
+					return static_cast<pool<T>&>(*pools.back());
+					}
+			};
+		}
+
 	//TODO ensure that all Types inherit from Base_type
-	template <template<class> class Container_type, typename Base_type, typename ...Types>
-	class polymorphic_container
+	template <template<template<class> class, typename> class Parent_storage, template<class> class Container_type, typename Base_type, typename ...Types>
+	class basic_polymorphic_container
 		{
 		public:
-			polymorphic_container() = default;
+			basic_polymorphic_container() = default;
 
 			template <typename Arg_parent, typename ...Args> //TODO can I split the variadic?
-			polymorphic_container(Arg_parent&& arg, Args&& ...args)
+				requires std::constructible_from<Parent_storage<Container_type, Base_type>, Arg_parent>
+			basic_polymorphic_container(Arg_parent&& arg, Args&& ...args)
 				: parent_container{std::forward<Arg_parent>(arg)}, set{std::forward<Args>(args)...} {}
 
 			template <typename msg_t, typename ...Args>
-			msg_t& emplace(Args ...args)
+			msg_t& emplace(Args&& ...args)
 				{
-				if constexpr (utils::variadic::contains_type<msg_t, Types...>::value)
+				if constexpr (utils::variadic::contains_type_v<msg_t, Types...>)
 					{
-					return container_emplace_helper<Container_type, msg_t>::emplace(set.get_containing_type<msg_t>(), std::forward<Args>(args)...);
-					}
-				else 
-					{ 
-					return
-						*dynamic_cast<msg_t*>(
-							&*container_emplace_helper<Container_type, utils::polymorphic_value<Base_type>>
-							::emplace(
-								parent_container, 
-								utils::make_polymorphic_value<msg_t>(std::forward<Args>(args)...)));
+					return container_emplace_helper<Container_type, msg_t>::emplace(set.template get_containing_type<msg_t>(), std::forward<Args>(args)...);
 					}
+				else { return parent_container.template emplace<msg_t>(std::forward<Args>(args)...); }
 				}
 
 			template <typename Function>
-			void for_each_container(Function function) { function(parent_container); set.for_each_container(function); }
+			void for_each_container(Function function) { parent_container.for_each_container(function); set.for_each_container(function); }
 			template <typename Function>
 			void for_each_element(Function function)
 				{
-				for (utils::polymorphic_value<Base_type>& polyval : parent_container) { function(*polyval); }
+				parent_container.for_each_element(function);
 				set.for_each_element(function);
 				}
 
+			// Parallel variants, see multitype_container; function is called concurrently.
+			template <typename Function>
+			void parallel_for_each_container(utils::thread_pool& threads, Function function)
+				{
+				threads.parallel_for(2, [&](size_t index)
+					{
+					if (index == 0) { parent_container.for_each_container(function); }
+					else { set.parallel_for_each_container(threads, function); }
+					});
+				}
+			template <typename Function>
+			void parallel_for_each_element(utils::thread_pool& threads, Function function, size_t chunk_size = utils::default_parallel_chunk_size)
+				{
+				threads.parallel_for(2, [&](size_t index)
+					{
+					if (index == 0) { parent_container.parallel_for_each_element(threads, function, chunk_size); }
+					else { set.parallel_for_each_element(threads, function, chunk_size); }
+					});
+				}
+
 			template <typename msg_t, typename Function>
-			void for_each_containing_type(Function function) { set.for_each_containing_type<msg_t>(function); }
+			void for_each_containing_type(Function function) { set.template for_each_containing_type<msg_t>(function); }
 
 			template <typename msg_t, typename Function>
 			void for_each_element_of_type(Function function)
 				{
-				for (utils::polymorphic_value<Base_type>& element : parent_container)
-					{
-					msg_t* element_cast = dynamic_cast<msg_t*>(&*element);
-					if (element_cast != nullptr)
-						{
-						function(*element_cast);
-						}
-					}
-
-				set.for_each_element_of_type<msg_t>(function);
+				parent_container.template for_each_element_of_type<msg_t>(function);
+				set.template for_each_element_of_type<msg_t>(function);
 				}
 
 			template <typename msg_t>
 			auto& get()
 				{
-				if constexpr (utils::variadic::contains_type<msg_t, Types...>::value) { return set.get_containing_type<msg_t>(); }
-				else { return parent_container; }
+				if constexpr (utils::variadic::contains_type_v<msg_t, Types...>) { return set.template get_containing_type<msg_t>(); }
+				else { return parent_container.get(); }
+				}
+
+			// Erases the elements matching predicate, which is called with a Base_type&. Doesn't preserve the order of the elements.
+			template <typename Predicate>
+			size_t erase_if(Predicate predicate) { return parent_container.erase_if(predicate) + set.erase_if(predicate); }
+
+			// Deferred erasure: marked elements stay in place, and are still visited, until compact() erases all of them in a single pass.
+			// Marked elements must not be relocated (i.e. by emplacing elements of the same type) before compact().
+			void mark_dead(const Base_type& element) { dead.push_back(&element); }
+
+			size_t compact()
+				{
+				if (dead.empty()) { return 0; }
+				std::ranges::sort(dead);
+				const size_t erased{erase_if([this](const Base_type& element) { return std::ranges::binary_search(dead, &element); })};
+				dead.clear();
+				return erased;
 				}
 
 			size_t size() { return parent_container.size() + set.size(); }
 
 		private:
 
-			Container_type<utils::polymorphic_value<Base_type>> parent_container;
+			Parent_storage<Container_type, Base_type> parent_container;
 			utils::multitype_container<Container_type, Types...> set;
+			std::vector<const Base_type*> dead;
 
 		};
 
-	}
\ No newline at end of file
+	// Unlisted types are individually allocated.
+	template <template<class> class Container_type, typename Base_type, typename ...Types>
+	using polymorphic_container = basic_polymorphic_container<polymorphic_storage::individual, Container_type, Base_type, Types...>;
+
+	// Unlisted types are grouped in contiguous per-type pools, see polymorphic_storage::segregated.
+	template <template<class> class Container_type, typename Base_type, typename ...Types>
+	using segregated_polymorphic_container = basic_polymorphic_container<polymorphic_storage::segregated, Container_type, Base_type, Types...>;
+	}
@@ -2,8 +2,17 @@
 
 #include <vector>
 #include <algorithm>
+#include <string>
+#include <array>
 #include <utils/containers/buffer.h>
 
+#ifdef utils_buffer_has_fd_io
+	#include <thread>
+	#include <chrono>
+	#include <csignal>
+	#include <pthread.h>
+#endif
+
 #include "CppUnitTest.h"
 
 
@@ -19,6 +28,25 @@ namespace Microsoft
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+struct PackedStruct { uint32_t a; float b; };
+struct PaddedStruct { char a; double b; };
+struct NestedStruct { PackedStruct packed; std::string name; PaddedStruct padded; };
+struct ArrayStruct { uint32_t id; std::array<uint16_t, 100> values; std::array<std::string, 3> names; };
+
+//Trivially copyable aggregates which can't be decomposed are copied as a block
+struct BaseStruct { uint32_t x; };
+struct DerivedStruct : BaseStruct { uint32_t y; };
+struct TaggedStruct { uint32_t id; char tag[4]; };
+//Can be decomposed for reading, so the padding after the bit-field isn't written
+struct BitFieldStruct { uint8_t flags : 3; uint32_t value; };
+static_assert(!utils::aggregate::reflectable<DerivedStruct>);
+static_assert(!utils::aggregate::reflectable<TaggedStruct>);
+static_assert(utils::aggregate::field_count<BitFieldStruct> == 2);
+
+//Probing the fields of large arrays stops past the reflectable limit
+static_assert(!utils::aggregate::reflectable<std::array<uint16_t, 100>>);
+static_assert(utils::aggregate::field_count<ArrayStruct> == 3);
+
 
 namespace Tests
 	{
@@ -54,5 +82,260 @@ namespace Tests
 
 				Assert::IsTrue(buffer.empty());
 				}
+
+			TEST_METHOD(strings)
+				{
+				utils::container::buffer buffer;
+
+				std::string s{"hello"};
+				buffer.push(s);
+
+				Assert::IsTrue(buffer.has<std::string>());
+				Assert::AreEqual(s, buffer.get<std::string>());
+				Assert::IsTrue(buffer.empty());
+
+				//A corrupt length prefix close to the maximum must not wrap around the size check
+				buffer.push(uint64_t{0} - 4);
+				buffer.push(uint32_t{0});
+				Assert::IsFalse(buffer.has<std::string>());
+				Assert::ExpectException<std::runtime_error>([&]() { buffer.get_except<std::string>(); });
+				}
+
+			TEST_METHOD(aggregates)
+				{
+				utils::container::buffer buffer;
+
+				buffer.push(PackedStruct{1, 2.f});
+				Assert::AreEqual(sizeof(PackedStruct), buffer.size());
+
+				buffer.push(PaddedStruct{'a', 3.0});
+				Assert::AreEqual(sizeof(PackedStruct) + sizeof(char) + sizeof(double), buffer.size()); //padding is not written
+
+				buffer.push(NestedStruct{{4, 5.f}, "hello", {'b', 6.0}});
+
+				PackedStruct packed = buffer.get<PackedStruct>();
+				Assert::AreEqual(uint32_t{1}, packed.a);
+				Assert::AreEqual(2.f, packed.b);
+
+				PaddedStruct padded = buffer.get<PaddedStruct>();
+				Assert::AreEqual('a', padded.a);
+				Assert::AreEqual(3.0, padded.b);
+
+				Assert::IsTrue(buffer.has<NestedStruct>());
+				NestedStruct nested = buffer.get<NestedStruct>();
+				Assert::AreEqual(uint32_t{4}, nested.packed.a);
+				Assert::AreEqual(std::string{"hello"}, nested.name);
+				Assert::AreEqual(6.0, nested.padded.b);
+
+				Assert::IsTrue(buffer.empty());
+				Assert::IsFalse(buffer.has<NestedStruct>());
+				}
+
+			TEST_METHOD(non_decomposable_aggregates)
+				{
+				utils::container::buffer buffer;
+
+				buffer.push(DerivedStruct{{1}, 2});
+				buffer.push(TaggedStruct{3, {'a', 'b', 'c', '\0'}});
+				buffer.push(BitFieldStruct{5, 6});
+				Assert::AreEqual(sizeof(DerivedStruct) + sizeof(TaggedStruct) + sizeof(uint8_t) + sizeof(uint32_t), buffer.size());
+
+				Assert::IsTrue(buffer.has<DerivedStruct>());
+				DerivedStruct derived = buffer.get<DerivedStruct>();
+				Assert::AreEqual(uint32_t{1}, derived.x);
+				Assert::AreEqual(uint32_t{2}, derived.y);
+
+				TaggedStruct tagged = buffer.get<TaggedStruct>();
+				Assert::AreEqual(uint32_t{3}, tagged.id);
+				Assert::AreEqual(std::string{"abc"}, std::string{tagged.tag});
+
+				Assert::IsTrue(buffer.has<BitFieldStruct>());
+				BitFieldStruct bit_field = buffer.get<BitFieldStruct>();
+				Assert::AreEqual(5, static_cast<int>(bit_field.flags));
+				Assert::AreEqual(uint32_t{6}, bit_field.value);
+				Assert::IsTrue(buffer.empty());
+				}
+
+			TEST_METHOD(arrays)
+				{
+				ArrayStruct value{7, {}, {"a", "bb", "a string long enough to be heap allocated"}};
+				for (uint16_t i = 0; i < value.values.size(); i++) { value.values[i] = i * 3; }
+
+				const auto check{[&](auto& buffer)
+					{
+					buffer.push(value.names);
+					buffer.push(value);
+					Assert::IsTrue(buffer.template has<std::array<std::string, 3>>());
+					Assert::IsTrue(buffer.template get<std::array<std::string, 3>>() == value.names);
+					Assert::IsTrue(buffer.template has<ArrayStruct>());
+					ArrayStruct read = buffer.template get<ArrayStruct>();
+					Assert::AreEqual(uint32_t{7}, read.id);
+					Assert::IsTrue(read.values == value.values);
+					Assert::IsTrue(read.names == value.names);
+					Assert::IsTrue(buffer.empty());
+					}};
+
+				utils::container::buffer buffer;
+				check(buffer);
+				//Not block copyable with swapped bytes, the arrays are written element by element
+				utils::container::basic_buffer<std::endian::big> big_endian;
+				check(big_endian);
+
+				big_endian.push(std::array<std::string, 2>{"a", "bb"});
+				Assert::IsFalse(big_endian.has<std::array<std::string, 3>>());
+				}
+
+			TEST_METHOD(byte_order)
+				{
+				utils::container::basic_buffer<std::endian::big> buffer;
+
+				buffer.push(uint32_t{0x01020304});
+				buffer.push(NestedStruct{{4, 5.f}, "hello", {'b', 6.0}});
+				Assert::AreEqual(uint8_t{0x01}, buffer.get<uint8_t>()); //most significant byte first
+
+				buffer.get<uint8_t>();
+				Assert::AreEqual(uint16_t{0x0304}, buffer.get<uint16_t>());
+
+				NestedStruct nested = buffer.get<NestedStruct>();
+				Assert::AreEqual(uint32_t{4}, nested.packed.a);
+				Assert::AreEqual(5.f, nested.packed.b);
+				Assert::AreEqual(std::string{"hello"}, nested.name);
+				Assert::AreEqual(6.0, nested.padded.b);
+				Assert::IsTrue(buffer.empty());
+				}
+
+			TEST_METHOD(header)
+				{
+				utils::container::little_endian_buffer buffer;
+
+				buffer.push_header(3);
+				buffer.push(1.5f);
+
+				Assert::AreEqual(uint32_t{3}, buffer.get_header());
+				Assert::AreEqual(1.5f, buffer.get<float>());
+
+				buffer.push(uint32_t{0});
+				Assert::ExpectException<std::runtime_error>([&]() { buffer.get_header(); });
+				}
+
+			TEST_METHOD(checksum)
+				{
+				utils::checksum::crc32c crc;
+				std::string check{"123456789"};
+				crc.update(reinterpret_cast<const std::byte*>(check.data()), check.size());
+				Assert::AreEqual(uint32_t{0xE3069283}, crc.value());
+
+				utils::container::checked_buffer buffer;
+				buffer.push(NestedStruct{{4, 5.f}, "hello", {'b', 6.0}});
+				buffer.push_checksum();
+				buffer.push(uint32_t{7});
+				buffer.push_checksum();
+
+				buffer.get<NestedStruct>();
+				buffer.get_checksum();
+				buffer.get<uint16_t>(); //reading the value differently than it was written still consumes the same bytes
+				buffer.get<uint16_t>();
+				buffer.get_checksum();
+				Assert::IsTrue(buffer.empty());
+
+				buffer.push(uint32_t{7});
+				buffer.push_checksum();
+				buffer.get<uint8_t>(); //leaves part of the value unread
+				Assert::ExpectException<std::runtime_error>([&]() { buffer.get_checksum(); });
+				}
+
+			TEST_METHOD(chunked_storage)
+				{
+				using chunked_buffer = utils::container::basic_buffer<std::endian::native, utils::checksum::none, utils::container::buffer_storage::chunked<8>>;
+				chunked_buffer buffer;
+
+				for (uint32_t i = 0; i < 100; i++) { buffer.push(NestedStruct{{i, 5.f}, std::string(i % 13, 'x'), {'b', 6.0}}); } //values straddle chunk boundaries
+
+				chunked_buffer copy{buffer};
+				for (uint32_t i = 0; i < 100; i++)
+					{
+					Assert::IsTrue(buffer.has<NestedStruct>());
+					NestedStruct nested = buffer.get<NestedStruct>();
+					Assert::AreEqual(i, nested.packed.a);
+					Assert::AreEqual(size_t{i % 13}, nested.name.size());
+					Assert::AreEqual(6.0, nested.padded.b);
+					}
+				Assert::IsTrue(buffer.empty());
+				Assert::IsTrue(utils::container::chunk_pool<8>::global().free_chunks_count() > 0); //consumed chunks are recycled
+
+				Assert::AreEqual(uint32_t{0}, copy.get<NestedStruct>().packed.a);
+				}
+
+#ifdef utils_buffer_has_fd_io
+			TEST_METHOD(file_descriptors)
+				{
+				pipe_round_trip<utils::container::buffer>();
+				pipe_round_trip<utils::container::basic_buffer<std::endian::native, utils::checksum::none, utils::container::buffer_storage::chunked<8>>>();
+				}
+
+			TEST_METHOD(file_descriptors_interrupted)
+				{
+				int fds[2];
+				Assert::AreEqual(0, ::pipe(fds));
+
+				//Without SA_RESTART a signal makes the blocked readv fail with EINTR
+				struct sigaction action{};
+				struct sigaction previous{};
+				action.sa_handler = [](int) {};
+				sigemptyset(&action.sa_mask);
+				::sigaction(SIGUSR1, &action, &previous);
+
+				utils::container::buffer in;
+				std::optional<size_t> received;
+				std::thread reader{[&]() { received = in.read_from(fds[0], 4); }};
+				std::this_thread::sleep_for(std::chrono::milliseconds{50});
+				::pthread_kill(reader.native_handle(), SIGUSR1);
+				std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+				utils::container::buffer out;
+				out.push(uint32_t{42});
+				Assert::AreEqual(size_t{4}, out.write_to(fds[1]));
+				reader.join();
+				::sigaction(SIGUSR1, &previous, nullptr);
+
+				Assert::IsTrue(received.has_value());
+				Assert::AreEqual(size_t{4}, *received);
+				Assert::AreEqual(uint32_t{42}, in.get<uint32_t>());
+				::close(fds[0]);
+				::close(fds[1]);
+				}
+
+			template <typename Buffer>
+			static void pipe_round_trip()
+				{
+				int fds[2];
+				Assert::AreEqual(0, ::pipe(fds));
+
+				Buffer out;
+				out.push(NestedStruct{{1, 2.f}, "hello", {'a', 3.0}});
+				out.push(std::string(300, 'x'));
+				const size_t total{out.size()};
+				size_t written{0};
+				while (!out.empty()) { written += out.write_to(fds[1]); }
+				Assert::AreEqual(total, written);
+				::close(fds[1]);
+
+				Buffer in;
+				Assert::AreEqual(size_t{5}, in.read_from(fds[0], 5).value());
+				Assert::IsFalse(in.template has<NestedStruct>()); //the value is split across reads
+				while (!in.template has<NestedStruct>()) { Assert::IsTrue(in.read_from(fds[0], 3).value() > 0); }
+				NestedStruct nested = in.template get<NestedStruct>();
+				Assert::AreEqual(uint32_t{1}, nested.packed.a);
+				Assert::AreEqual(std::string{"hello"}, nested.name);
+				Assert::AreEqual(3.0, nested.padded.b);
+
+				while (in.read_from(fds[0], 64).value() > 0) {}
+				Assert::AreEqual(std::string(300, 'x'), in.template get<std::string>());
+				Assert::IsTrue(in.empty());
+
+				Assert::ExpectException<std::runtime_error>([&]() { in.read_from(fds[0], 0); });
+				::close(fds[0]);
+				}
+#endif
 		};
 	}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <span>
+#include <string>
+#include <ranges>
+#include <numeric>
+#include "../Beta/include/utils/containers/listed_array.h"
+
+namespace
+	{
+	//Not a power of two, elements don't line up with any division shortcut
+	using array_t = utils::listed_array<int, 7>;
+	static_assert(std::ranges::bidirectional_range<array_t>);
+	static_assert(std::ranges::bidirectional_range<const array_t>);
+	}
+
+namespace Tests
+	{
+	TEST_CLASS(Listed_array)
+		{
+		public:
+
+			TEST_METHOD(iterators)
+				{
+				array_t array;
+				Assert::IsTrue(array.begin() == array.end());
+
+				for (int count : {1, 6, 7, 8, 14, 30})
+					{
+					array.clear();
+					for (int i = 0; i < count; i++) { array.emplace_back(i); }
+
+					int expected = 0;
+					for (int& element : array) { Assert::AreEqual(element, expected++); }
+					Assert::AreEqual(expected, count);
+
+					//Backwards from the end, across chunk boundaries
+					auto it = array.end();
+					for (int i = count - 1; i >= 0; i--) { Assert::AreEqual(*--it, i); }
+					Assert::IsTrue(it == array.begin());
+
+					const array_t& const_array = array;
+					Assert::AreEqual(std::accumulate(const_array.begin(), const_array.end(), 0), count * (count - 1) / 2);
+					}
+
+				//Spare capacity in a chunk after the last element
+				array.clear();
+				array.reserve(20);
+				for (int i = 0; i < 14; i++) { array.push_back(i); }
+				Assert::AreEqual(static_cast<int>(std::ranges::distance(array)), 14);
+				}
+
+			TEST_METHOD(iterators_across_growth)
+				{
+				//Chunks don't move when the array grows, iterators to elements stay valid
+				utils::listed_array<int, 2> array;
+				array.push_back(0);
+				array.push_back(1);
+				auto it = array.begin();
+				const auto& element = *std::next(it);
+				for (int i = 2; i < 100; i++) { array.push_back(i); }
+
+				++it;
+				++it;
+				Assert::AreEqual(*it, 2);
+				Assert::AreEqual(element, 1);
+
+				int expected = 2;
+				for (; it != array.end(); ++it) { Assert::AreEqual(*it, expected++); }
+				Assert::AreEqual(expected, 100);
+				}
+
+			TEST_METHOD(chunks)
+				{
+				array_t array;
+				for (int i = 0; i < 30; i++) { array.push_back(i); }
+
+				std::vector<size_t> sizes;
+				int sum = 0;
+				array.for_each_chunk([&](std::span<int> chunk)
+					{
+					sizes.push_back(chunk.size());
+					for (int& element : chunk) { sum += element; element *= 2; }
+					});
+				Assert::IsTrue(sizes == std::vector<size_t>{7, 7, 7, 7, 2});
+				Assert::AreEqual(sum, 435);
+				Assert::AreEqual(array[29], 58);
+
+				//Copies go through the chunks too, and copy non trivial types
+				utils::listed_array<std::string, 3> strings;
+				for (int i = 0; i < 10; i++) { strings.emplace_back(std::to_string(i) + " is a long enough string to be heap allocated"); }
+				utils::listed_array<std::string, 3> copy{strings};
+				strings.clear();
+				Assert::AreEqual(copy.size(), size_t{10});
+				Assert::AreEqual(copy.back().substr(0, 2), std::string{"9 "});
+				}
+		};
+	}
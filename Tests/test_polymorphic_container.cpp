@@ -0,0 +1,273 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <utils/containers/slot_map.h>
+#include "../Beta/include/utils/containers/listed_array.h"
+#include "../Beta/include/utils/containers/polymorphic_container.h"
+
+namespace
+	{
+	struct Base
+		{
+		virtual ~Base() = default;
+		virtual int value() const = 0;
+		};
+
+	struct Listed : Base
+		{
+		Listed(int n) : n{n} {}
+		int value() const override { return n; }
+		int n;
+		};
+
+	// Types the container doesn't know about, like the ones defined by a plugin.
+	struct Unlisted : Base
+		{
+		Unlisted(int n) : n{n} {}
+		int value() const override { return n * 10; }
+		int n;
+		};
+
+	struct Named { virtual ~Named() = default; std::string name{"named"}; };
+	struct Unlisted_offset : Named, Base
+		{
+		Unlisted_offset(int n) : n{n} {}
+		int value() const override { return n * 100; }
+		int n;
+		};
+
+	struct Unlisted_derived : Unlisted { using Unlisted::Unlisted; };
+
+	template <typename T>
+	using chunked = utils::listed_array<T, 32>;
+
+	// Emplacing many elements mustn't move the first ones, with containers that don't relocate.
+	template <typename Container>
+	void check_stable(Container& container)
+		{
+		Listed& listed{container.template emplace<Listed>(-1)};
+		Unlisted& unlisted{container.template emplace<Unlisted>(-1)};
+		fill(container);
+		Assert::AreEqual(listed.n, -1);
+		Assert::AreEqual(unlisted.n, -1);
+
+		container.mark_dead(listed);
+		container.mark_dead(unlisted);
+		Assert::AreEqual(container.compact(), size_t{2});
+		check(container);
+		}
+
+	template <typename Container>
+	void fill(Container& container)
+		{
+		for (int i = 0; i < 100; i++)
+			{
+			container.template emplace<Listed>(i);
+			container.template emplace<Unlisted>(i);
+			container.template emplace<Unlisted_offset>(i);
+			container.template emplace<Unlisted_derived>(i);
+			}
+		}
+
+	template <typename Container>
+	void check(Container& container)
+		{
+		Assert::AreEqual(container.size(), size_t{400});
+
+		int sum{0};
+		container.for_each_element([&](Base& element) { sum += element.value(); });
+		Assert::AreEqual(sum, 4950 * (1 + 10 + 100 + 10));
+
+		int unlisted{0};
+		int unlisted_sum{0};
+		container.template for_each_element_of_type<Unlisted>([&](Unlisted& element) { unlisted++; unlisted_sum += element.n; });
+		Assert::AreEqual(unlisted, 200);
+		Assert::AreEqual(unlisted_sum, 4950 * 2);
+
+		int named{0};
+		container.template for_each_element_of_type<Named>([&](Named& element) { if (element.name == "named") { named++; } });
+		Assert::AreEqual(named, 100);
+
+		size_t elements{0};
+		container.for_each_container([&](auto& inner) { for (auto& element : inner) { (void)element; elements++; } });
+		Assert::AreEqual(elements, size_t{400});
+		}
+
+	template <typename Container>
+	void check_parallel(Container& container)
+		{
+		utils::thread_pool threads{3};
+
+		std::atomic<int> sum{0};
+		std::atomic<size_t> visited{0};
+		container.parallel_for_each_element(threads, [&](Base& element) { sum += element.value(); visited++; }, 16);
+		Assert::AreEqual(visited.load(), size_t{400});
+		Assert::AreEqual(sum.load(), 4950 * (1 + 10 + 100 + 10));
+
+		std::atomic<size_t> elements{0};
+		container.parallel_for_each_container(threads, [&](auto& inner) { for (auto& element : inner) { (void)element; elements++; } });
+		Assert::AreEqual(elements.load(), size_t{400});
+		}
+
+	template <typename Container>
+	void check_erase(Container& container)
+		{
+		//Multiples of 10 from each type
+		Assert::AreEqual(container.erase_if([](const Base& element) { return element.value() % 10 != 0; }), size_t{90 + 0 + 0 + 0});
+		Assert::AreEqual(container.size(), size_t{310});
+
+		//Deferred: marked elements are still visited until compacted
+		container.for_each_element([&](Base& element) { if (element.value() >= 500) { container.mark_dead(element); } });
+		Assert::AreEqual(container.size(), size_t{310});
+		Assert::AreEqual(container.compact(), size_t{95 + 50 + 50});
+		Assert::AreEqual(container.size(), size_t{115});
+		Assert::AreEqual(container.compact(), size_t{0});
+
+		int sum{0};
+		container.for_each_element([&](Base& element) { sum += element.value(); });
+		Assert::AreEqual(sum, 450 + 1225 * 10 * 2 + 1000);
+
+		int unlisted{0};
+		container.template for_each_element_of_type<Unlisted>([&](Unlisted&) { unlisted++; });
+		Assert::AreEqual(unlisted, 100);
+		int named{0};
+		container.template for_each_element_of_type<Named>([&](Named&) { named++; });
+		Assert::AreEqual(named, 5);
+
+		//Elements moved into the place of marked ones aren't erased
+		container.for_each_element([&](Base& element) { if (element.value() < 30) { container.mark_dead(element); } });
+		Assert::AreEqual(container.compact(), size_t{3 + 3 + 3 + 1});
+		int listed{0};
+		container.template for_each_element_of_type<Listed>([&](Listed& element) { listed += element.n; });
+		Assert::AreEqual(listed, 450 - 30);
+		}
+
+	// Types stored after a type was queried are found by later queries of that type.
+	template <typename Container>
+	void check_incremental_queries(Container& container)
+		{
+		int found{0};
+		container.template for_each_element_of_type<Unlisted>([&](Unlisted&) { found++; });
+		Assert::AreEqual(found, 0);
+
+		container.template emplace<Unlisted>(1);
+		container.template emplace<Unlisted_offset>(2);
+		container.template emplace<Unlisted_derived>(3);
+		container.template emplace<Unlisted_derived>(4);
+
+		int sum{0};
+		container.template for_each_element_of_type<Unlisted>([&](Unlisted& element) { sum += element.n; });
+		Assert::AreEqual(sum, 1 + 3 + 4);
+
+		sum = 0;
+		container.template for_each_element_of_type<Unlisted_derived>([&](Unlisted_derived& element) { sum += element.n; });
+		Assert::AreEqual(sum, 3 + 4);
+
+		sum = 0;
+		container.template for_each_element_of_type<Base>([&](Base& element) { sum += element.value(); });
+		Assert::AreEqual(sum, 10 + 200 + 30 + 40);
+		}
+	}
+
+namespace Tests
+	{
+	TEST_CLASS(Polymorphic_container)
+		{
+		public:
+
+			TEST_METHOD(individual_storage)
+				{
+				utils::polymorphic_container<std::vector, Base, Listed> container;
+				fill(container);
+				check(container);
+				check_parallel(container);
+				check_erase(container);
+				}
+
+			TEST_METHOD(stable_containers)
+				{
+					{
+					utils::polymorphic_container<std::deque, Base, Listed> container;
+					check_stable(container);
+					}
+					{
+					utils::polymorphic_container<chunked, Base, Listed> container;
+					check_stable(container);
+					}
+
+				//Handle based containers
+				utils::polymorphic_container<utils::container::slot_map, Base, Listed> container;
+				Assert::AreEqual(container.emplace<Listed>(1).n, 1);
+				Assert::AreEqual(container.emplace<Unlisted>(2).n, 2);
+				int sum{0};
+				container.for_each_element([&](Base& element) { sum += element.value(); });
+				Assert::AreEqual(sum, 1 + 20);
+
+				//Handles survive erasures, which go through the slot_map
+				auto& listed{container.get<Listed>()};
+				const auto first{listed.handle_of(container.emplace<Listed>(3))};
+				for (int i = 4; i < 10; i++) { container.emplace<Listed>(i); }
+				const auto last{listed.handle_of(container.emplace<Listed>(10))};
+				for (int i = 0; i < 5; i++) { container.emplace<Unlisted>(i); }
+
+				Assert::AreEqual(container.erase_if([](const Base& element) { return element.value() % 2 == 0 && element.value() < 10; }), size_t{4});
+				container.for_each_element([&](Base& element) { if (element.value() == 30 || element.value() == 5) { container.mark_dead(element); } });
+				Assert::AreEqual(container.compact(), size_t{2});
+				Assert::AreEqual(container.size(), size_t{9});
+				Assert::AreEqual(listed[first].n, 3);
+				Assert::AreEqual(listed[last].n, 10);
+				sum = 0;
+				container.for_each_element([&](Base& element) { sum += element.value(); });
+				Assert::AreEqual(sum, 1 + 3 + 7 + 9 + 10 + 20 + 10 + 20 + 40);
+				}
+
+			TEST_METHOD(individual_storage_queries)
+				{
+				utils::polymorphic_container<std::vector, Base, Listed> container;
+				check_incremental_queries(container);
+
+				//Copies index their own elements
+				auto copy{container};
+				copy.for_each_element_of_type<Unlisted_derived>([&](Unlisted_derived& element) { element.n = 0; });
+				int sum{0};
+				copy.for_each_element_of_type<Unlisted>([&](Unlisted& element) { sum += element.n; });
+				Assert::AreEqual(sum, 1);
+				sum = 0;
+				container.for_each_element_of_type<Unlisted>([&](Unlisted& element) { sum += element.n; });
+				Assert::AreEqual(sum, 1 + 3 + 4);
+				}
+
+			TEST_METHOD(segregated_storage_queries)
+				{
+				utils::segregated_polymorphic_container<std::vector, Base, Listed> container;
+				check_incremental_queries(container);
+				}
+
+			TEST_METHOD(segregated_storage)
+				{
+				utils::segregated_polymorphic_container<std::vector, Base, Listed> container;
+				fill(container);
+				check(container);
+				check_parallel(container);
+
+				//Each unlisted type is stored contiguously
+				auto& parent{container.get<Unlisted>()};
+				const Base* previous{nullptr};
+				size_t contiguous{0};
+				for (const Base& element : parent)
+					{
+					if (previous && dynamic_cast<const Unlisted_offset*>(previous) && reinterpret_cast<const std::byte*>(&element) - reinterpret_cast<const std::byte*>(previous) == sizeof(Unlisted_offset)) { contiguous++; }
+					previous = &element;
+					}
+				Assert::AreEqual(contiguous, size_t{99});
+
+				check_erase(container);
+				}
+		};
+	}
@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <array>
+#include <string>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <utils/polymorphic_value.h>
+
+namespace
+	{
+	int alive{0};
+
+	struct Base
+		{
+		Base() { alive++; }
+		Base(const Base&) { alive++; }
+		Base(Base&&) noexcept { alive++; }
+		virtual ~Base() { alive--; }
+		virtual int value() const = 0;
+		};
+
+	struct Small : Base
+		{
+		Small(int n) : n{n} {}
+		int value() const override { return n; }
+		int n;
+		};
+
+	struct Large : Base
+		{
+		Large(int n) : n{n} {}
+		int value() const override { return n + static_cast<int>(padding.size()); }
+		int n;
+		std::array<char, 256> padding{};
+		};
+
+	// Not the first base, so that its subobject isn't at the start of the object.
+	struct Other { virtual ~Other() = default; int other{7}; };
+	struct Offset : Other, Base
+		{
+		Offset(int n) : n{n} {}
+		int value() const override { return n; }
+		int n;
+		};
+
+	using small_value = utils::polymorphic_value<Base, 64>;
+
+	struct Derived : Small { using Small::Small; int value() const override { return n * 10; } };
+
+	struct counting_copier
+		{
+		int* copies;
+		Small* operator()(const Small& small) const { (*copies)++; return new Small(small); }
+		};
+	}
+
+namespace Tests
+	{
+	TEST_CLASS(Polymorphic_value)
+		{
+		public:
+
+			TEST_METHOD(inline_storage)
+				{
+					{
+					small_value a{std::in_place_type<Small>, 1};
+					small_value b{std::in_place_type<Large>, 2};
+					Assert::IsTrue(a.is_inline());
+					Assert::IsFalse(b.is_inline());
+
+					small_value c{a};
+					small_value d{std::move(b)};
+					Assert::IsTrue(c.is_inline());
+					Assert::AreEqual(c->value(), 1);
+					Assert::AreEqual(d->value(), 258);
+					Assert::IsFalse(static_cast<bool>(b));
+
+					a.swap(d);
+					Assert::AreEqual(a->value(), 258);
+					Assert::AreEqual(d->value(), 1);
+					Assert::IsTrue(d.is_inline());
+
+					std::vector<small_value> values;
+					for (int i = 0; i < 100; i++) { values.emplace_back(std::in_place_type<Small>, i); }
+					Assert::AreEqual(values[42]->value(), 42);
+					}
+				Assert::AreEqual(alive, 0);
+				}
+
+			TEST_METHOD(inline_conversions)
+				{
+					{
+					utils::polymorphic_value<Offset, 64> offset{std::in_place_type<Offset>, 3};
+					small_value converted{offset};
+					Assert::IsTrue(converted.is_inline());
+					Assert::AreEqual(converted->value(), 3);
+
+					//Not enough inline space, the object moves to the heap
+					utils::polymorphic_value<Base, 8> heap{std::move(converted)};
+					Assert::IsFalse(heap.is_inline());
+					Assert::AreEqual(heap->value(), 3);
+
+					utils::polymorphic_value<Base, 8> copy{heap};
+					Assert::AreEqual(copy->value(), 3);
+					utils::polymorphic_value<Base> plain{copy};
+					Assert::AreEqual(plain->value(), 3);
+					}
+				Assert::AreEqual(alive, 0);
+				}
+
+			TEST_METHOD(allocator)
+				{
+					{
+					std::array<std::byte, 4096> arena;
+					std::pmr::monotonic_buffer_resource resource{arena.data(), arena.size(), std::pmr::null_memory_resource()};
+					const auto in_arena{[&](const Base* base)
+						{
+						const auto* address{reinterpret_cast<const std::byte*>(base)};
+						return address >= arena.data() && address < arena.data() + arena.size();
+						}};
+
+					auto a{utils::allocate_polymorphic_value<Base, Large>(std::pmr::polymorphic_allocator<>{&resource}, 1)};
+					Assert::IsTrue(in_arena(&*a));
+					Assert::AreEqual(a->value(), 257);
+
+					//Copies are cloned from the same arena
+					utils::polymorphic_value<Base> b{a};
+					Assert::IsTrue(in_arena(&*b));
+					Assert::IsTrue(&*a != &*b);
+
+					//Objects which fit the inline storage don't touch the arena
+					small_value c{std::allocator_arg, std::pmr::polymorphic_allocator<>{&resource}, std::in_place_type<Small>, 2};
+					Assert::IsTrue(c.is_inline());
+					Assert::IsFalse(in_arena(&*c));
+					}
+				Assert::AreEqual(alive, 0);
+				}
+
+			TEST_METHOD(copy_on_write)
+				{
+					{
+					auto a{utils::make_cow_polymorphic_value<Base, Small>(1)};
+					auto b{a};
+					auto c{a};
+					Assert::IsTrue(&*std::as_const(a) == &*std::as_const(b));
+					Assert::IsTrue(a.is_shared());
+					Assert::AreEqual(alive, 1);
+
+					//First mutable access clones, the other copies keep sharing
+					static_cast<Small&>(*b).n = 2;
+					Assert::AreEqual(alive, 2);
+					Assert::IsFalse(b.is_shared());
+					Assert::AreEqual(std::as_const(a)->value(), 1);
+					Assert::AreEqual(std::as_const(b)->value(), 2);
+					Assert::IsTrue(&*std::as_const(a) == &*std::as_const(c));
+
+					//No clone once unshared
+					static_cast<Small&>(*b).n = 3;
+					Assert::AreEqual(alive, 2);
+					}
+				Assert::AreEqual(alive, 0);
+				}
+
+			TEST_METHOD(heap_conversions_and_copiers)
+				{
+					{
+					//Converting back and forth doesn't pile up indirections
+					utils::polymorphic_value<Derived> derived{std::in_place_type<Derived>, 4};
+					utils::polymorphic_value<Small> small{std::move(derived)};
+					utils::polymorphic_value<Base> base{small};
+					Assert::AreEqual(base->value(), 40);
+					Assert::AreEqual(small->value(), 40);
+					Assert::IsTrue(&*base != &*small);
+					utils::polymorphic_value<Base> copy{base};
+					Assert::AreEqual(copy->value(), 40);
+
+					utils::polymorphic_value<Offset> offset{std::in_place_type<Offset>, 5};
+					utils::polymorphic_value<Base> offset_base{offset};
+					utils::polymorphic_value<Base> offset_copy{offset_base};
+					Assert::AreEqual(offset_copy->value(), 5);
+					Assert::AreEqual(dynamic_cast<const Offset&>(*offset_copy).other, 7);
+
+					int copies{0};
+					utils::polymorphic_value<Base> custom{new Small{6}, counting_copier{&copies}};
+					utils::polymorphic_value<Base> custom_copy{custom};
+					Assert::AreEqual(copies, 1);
+					Assert::AreEqual(custom_copy->value(), 6);
+
+					//Ownership isn't taken when the construction throws
+					std::unique_ptr<Small> mismatched{new Derived{1}};
+					Assert::ExpectException<utils::bad_polymorphic_value_construction>([&] { utils::polymorphic_value<Small> mismatch{mismatched.get()}; });
+					}
+				Assert::AreEqual(alive, 0);
+				}
+		};
+	}
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <string>
+#include <atomic>
+#include <ranges>
+#include <utils/containers/soa_vector.h>
+#include "../Beta/include/utils/containers/multitype_container.h"
+
+namespace
+	{
+	struct particle
+		{
+		float x;
+		float y;
+		float speed;
+		std::string name;
+		};
+
+	struct counter
+		{
+		int value;
+		};
+
+	//Random access, so utils::parallel_for_each splits it in chunks
+	static_assert(std::ranges::random_access_range<utils::container::soa_vector<particle>>);
+	static_assert(std::ranges::random_access_range<const utils::container::soa_vector<particle>>);
+	}
+
+namespace Tests
+	{
+	TEST_CLASS(Soa_vector)
+		{
+		public:
+
+			TEST_METHOD(fields)
+				{
+				utils::container::soa_vector<particle> particles;
+				for (int i = 0; i < 100; i++) { particles.emplace_back(float(i), 0.f, 2.f, "p" + std::to_string(i)); }
+				Assert::AreEqual(particles.size(), size_t{100});
+
+				//Fields are stored in separate arrays
+				Assert::IsTrue(particles.column<0>().data() + 1 == &particles[1].get<0>());
+				Assert::AreEqual(particles.column<3>()[42], std::string{"p42"});
+
+				particles.for_each<1, 2>([](float& y, const float& speed) { y += speed; });
+				particle copy = particles[10];
+				Assert::AreEqual(copy.x, 10.f);
+				Assert::AreEqual(copy.y, 2.f);
+				Assert::AreEqual(copy.name, std::string{"p10"});
+
+				particles[0] = particle{-1.f, -2.f, -3.f, "first"};
+				particles[1] = particles[0];
+				Assert::AreEqual(particles[1].get<3>(), std::string{"first"});
+
+				particles.erase(particles.begin() + 1, particles.end() - 1);
+				Assert::AreEqual(particles.size(), size_t{2});
+				Assert::AreEqual(particles.back().get<3>(), std::string{"p99"});
+
+				float sum{0};
+				for (auto&& element : std::as_const(particles)) { sum += element.get<0>(); }
+				Assert::AreEqual(sum, 98.f);
+				Assert::ExpectException<std::out_of_range>([&] { particles.at(2); });
+				}
+
+			TEST_METHOD(in_multitype_container)
+				{
+				utils::multitype_container<utils::container::soa_vector, particle, counter> set;
+				auto& particles{set.get_containing_type<particle>()};
+				for (int i = 0; i < 10; i++) { particles.emplace_back(float(i), 0.f, 1.f, "p"); }
+				set.get_containing_type<counter>().push_back({5});
+
+				size_t visited{0};
+				set.for_each_element([&](const auto& element) { (void)element; visited++; });
+				Assert::AreEqual(visited, size_t{11});
+
+				utils::thread_pool threads{2};
+				std::atomic<size_t> parallel_visited{0};
+				set.parallel_for_each_element(threads, [&](const auto&) { parallel_visited++; });
+				Assert::AreEqual(parallel_visited.load(), size_t{11});
+
+				Assert::AreEqual(set.erase_if([](const auto& element) { return element.template get<0>() < 2; }), size_t{2});
+				set.for_each_element_of_type<particle>([&](const auto& element) { if (element.template get<0>() >= 8) { set.mark_dead(element); } });
+				Assert::AreEqual(set.compact(), size_t{2});
+				Assert::AreEqual(particles.size(), size_t{6});
+				for (auto&& element : particles) { Assert::IsTrue(element.get<0>() >= 2 && element.get<0>() < 8); }
+				}
+		};
+	}
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <atomic>
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <utils/thread_pool.h>
+
+namespace Tests
+	{
+	TEST_CLASS(Thread_pool)
+		{
+		public:
+
+			TEST_METHOD(parallel_for)
+				{
+				utils::thread_pool threads{3};
+
+				std::vector<int> values(10'000, 0);
+				threads.parallel_for(values.size(), [&](size_t i) { values[i] += static_cast<int>(i); });
+				Assert::AreEqual(std::accumulate(values.begin(), values.end(), int64_t{0}), int64_t{9'999} * 10'000 / 2);
+
+				//Nested calls are helped by the waiting threads instead of deadlocking
+				std::atomic<size_t> calls{0};
+				threads.parallel_for(8, [&](size_t) { threads.parallel_for(100, [&](size_t) { calls++; }); });
+				Assert::AreEqual(calls.load(), size_t{800});
+
+				std::atomic<int> sum{0};
+				utils::parallel_for_each(threads, values, [&](int value) { sum += value % 7; }, 100);
+				int expected{0};
+				for (int value : values) { expected += value % 7; }
+				Assert::AreEqual(sum.load(), expected);
+				}
+
+			TEST_METHOD(exceptions)
+				{
+				utils::thread_pool threads{2};
+				std::atomic<size_t> calls{0};
+				Assert::ExpectException<std::runtime_error>([&]
+					{
+					threads.parallel_for(1'000, [&](size_t i) { calls++; if (i == 10) { throw std::runtime_error{"failed"}; } });
+					});
+				Assert::IsTrue(calls.load() <= 1'000);
+
+				//The pool is still usable
+				calls = 0;
+				threads.parallel_for(10, [&](size_t) { calls++; });
+				Assert::AreEqual(calls.load(), size_t{10});
+				}
+		};
+	}
@@ -5,7 +5,13 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 #include <vector>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <optional>
 #include <utils/tracking.h>
+#include <utils/containers/tracked_vector.h>
+#include <utils/containers/slot_map.h>
 
 
 struct TrackableClass : public utils::trackable
@@ -26,6 +32,33 @@ struct SomeClass
 
 using WrappedClass = utils::trackable_wrapper<SomeClass>;
 
+struct PooledTrackableClass : public utils::basic_trackable<utils::pooled_tracking_policy>
+	{
+	PooledTrackableClass(int n) : n(n) {}
+	int n = 0;
+	};
+
+using PooledWrappedClass = utils::trackable_wrapper<SomeClass, utils::pooled_tracking_policy>;
+
+//Erasing move assigns the last element in the erased one's place
+struct ThrowingMove { ThrowingMove& operator=(ThrowingMove&&) { return *this; } };
+static_assert( noexcept(std::declval<utils::container::slot_map<SomeClass>&>().erase({})));
+static_assert(!noexcept(std::declval<utils::container::slot_map<ThrowingMove>&>().erase({})));
+
+struct SingleThreadedTrackableClass : public utils::basic_trackable<utils::single_threaded_tracking_policy>
+	{
+	SingleThreadedTrackableClass(int n) : n(n) {}
+	int n = 0;
+	};
+
+struct LazyTrackableClass : public utils::basic_trackable<utils::lazy_tracking_policy>
+	{
+	LazyTrackableClass(int n) : n(n) {}
+	int n = 0;
+	};
+using LazyWrappedClass = utils::trackable_wrapper<SomeClass, utils::lazy_tracking_policy>;
+using ConcurrentWrappedClass = utils::trackable_wrapper<SomeClass, utils::concurrent_tracking_policy>;
+
 namespace Tests
 	{
 	TEST_CLASS(Tracking)
@@ -200,5 +233,229 @@ namespace Tests
 				Assert::AreEqual(ptr6->n, 6);
 				}
 
+			TEST_METHOD(move_around_vector_pooled)
+				{
+				std::vector<PooledTrackableClass> vec;
+				std::vector<PooledWrappedClass> wrapped_vec;
+
+				for (int i = 0; i < 100; i++) { vec.emplace_back(i); wrapped_vec.emplace_back(i); }
+
+				utils::tracking_ptr<PooledTrackableClass> ptr{vec[20]};
+				utils::tracking_ptr<SomeClass, utils::pooled_tracking_policy> wrapped_ptr{wrapped_vec[40]};
+
+				std::reverse(vec.begin(), vec.end());
+				std::reverse(wrapped_vec.begin(), wrapped_vec.end());
+
+				Assert::IsTrue(&*ptr == &vec[79]);
+				Assert::AreEqual(ptr->n, 20);
+				Assert::IsTrue(&*wrapped_ptr == &*wrapped_vec[59]);
+				Assert::AreEqual(wrapped_ptr->n, 40);
+
+				vec.clear();
+				wrapped_vec.clear();
+				Assert::IsFalse(static_cast<bool>(ptr));
+				Assert::IsFalse(static_cast<bool>(wrapped_ptr));
+				}
+
+			TEST_METHOD(pooled_after_thread_pool_destruction)
+				{
+				static std::atomic<bool> late_tracking{false};
+				struct late_holder
+					{
+					PooledTrackableClass object{1};
+					std::optional<utils::tracking_ptr<PooledTrackableClass>> ptr;
+					~late_holder()
+						{
+						//The thread's pool is gone: releasing and creating trackers goes through the shared depot
+						ptr.reset();
+						utils::tracking_ptr<PooledTrackableClass> late{object};
+						late_tracking = &*late == &object;
+						}
+					};
+
+				std::thread{[]
+					{
+					//Constructed before the thread's pool, so destroyed after it
+					thread_local late_holder holder;
+					holder.ptr.emplace(holder.object);
+					}}.join();
+				Assert::IsTrue(late_tracking);
+				}
+
+			TEST_METHOD(move_around_vector_single_threaded)
+				{
+				std::vector<SingleThreadedTrackableClass> vec;
+				for (int i = 0; i < 100; i++) { vec.emplace_back(i); }
+
+				utils::tracking_ptr<SingleThreadedTrackableClass> ptr{vec[20]};
+				utils::tracking_ptr<SingleThreadedTrackableClass> copy{ptr};
+
+				std::reverse(vec.begin(), vec.end());
+				Assert::AreEqual(ptr->n, 20);
+				Assert::IsTrue(&*copy == &vec[79]);
+
+				vec.clear();
+				Assert::IsFalse(static_cast<bool>(copy));
+				}
+
+			TEST_METHOD(move_around_vector_lazy)
+				{
+				std::vector<LazyTrackableClass> vec;
+				std::vector<LazyWrappedClass> wrapped_vec;
+				for (int i = 0; i < 100; i++) { vec.emplace_back(i); wrapped_vec.emplace_back(i); }
+
+				utils::tracking_ptr<LazyTrackableClass> ptr{vec[20]};
+				utils::tracking_ptr<SomeClass, utils::lazy_tracking_policy> wrapped_ptr{wrapped_vec[40]};
+
+				for (int i = 0; i < 1000; i++) { vec.emplace_back(i); wrapped_vec.emplace_back(i); }
+				std::reverse(vec.begin(), vec.end());
+				Assert::AreEqual(ptr->n, 20);
+				Assert::AreEqual(wrapped_ptr->n, 40);
+
+				//A moved-from trackable gets its tracker once someone tracks it
+				LazyTrackableClass moved{std::move(vec[0])};
+				utils::tracking_ptr<LazyTrackableClass> moved_from_ptr{vec[0]};
+				Assert::IsTrue(moved_from_ptr.get() == &vec[0]);
+
+				vec.clear();
+				wrapped_vec.clear();
+				Assert::IsFalse(static_cast<bool>(ptr));
+				Assert::IsFalse(static_cast<bool>(wrapped_ptr));
+				Assert::IsFalse(static_cast<bool>(moved_from_ptr));
+				}
+
+
+			TEST_METHOD(tracked_vector)
+				{
+				utils::container::tracked_vector<SomeClass> vec;
+				for (int i = 0; i < 10; i++) { vec.emplace_back(i); }
+
+				utils::tracking_ptr<SomeClass> ptr2{vec.track(2)};
+				utils::tracking_ptr<SomeClass> ptr4{vec.track(4)};
+				utils::tracking_ptr<SomeClass> ptr6{vec.track(6)};
+
+				for (int i = 10; i < 1000; i++) { vec.emplace_back(i); }
+				Assert::IsTrue(ptr2.get() == &vec[2]);
+				Assert::AreEqual(ptr6->n, 6);
+
+				vec.erase(vec.begin() + 4);
+				Assert::IsFalse(static_cast<bool>(ptr4));
+				Assert::IsTrue(ptr6.get() == &vec[5]);
+				Assert::AreEqual(ptr6->n, 6);
+
+				utils::container::tracked_vector<SomeClass> moved{std::move(vec)};
+				Assert::IsTrue(ptr2.get() == &moved[2]);
+
+				moved.clear();
+				Assert::IsFalse(static_cast<bool>(ptr2));
+				Assert::IsFalse(static_cast<bool>(ptr6));
+				}
+
+			TEST_METHOD(tracked_vector_non_trivial)
+				{
+				utils::container::tracked_vector<std::vector<int>, utils::single_threaded_tracking_policy> vec;
+				for (int i = 0; i < 100; i++) { vec.push_back(std::vector<int>(i, i)); }
+
+				utils::tracking_ptr<std::vector<int>, utils::single_threaded_tracking_policy> ptr{vec.track(50)};
+				vec.reserve(1000);
+				vec.erase(vec.begin());
+				Assert::IsTrue(ptr.get() == &vec[49]);
+				Assert::AreEqual(ptr->size(), size_t{50});
+
+				vec.pop_back();
+				utils::container::tracked_vector<std::vector<int>, utils::single_threaded_tracking_policy> copy{vec};
+				Assert::AreEqual(copy.size(), size_t{98});
+				Assert::IsTrue(ptr.get() == &vec[49]);
+				}
+
+			TEST_METHOD(tracked_vector_throwing_copy)
+				{
+				static int alive{0};
+				struct Throwing
+					{
+					int n;
+					Throwing(int n) : n{n} { alive++; }
+					Throwing(const Throwing& copy) : n{copy.n} { if (n == 5) { throw std::runtime_error{"copy"}; } alive++; }
+					Throwing(Throwing&& move) noexcept : n{move.n} { alive++; }
+					~Throwing() { alive--; }
+					};
+
+					{
+					utils::container::tracked_vector<Throwing> vec;
+					for (int i = 0; i < 10; i++) { vec.emplace_back(i); }
+					//The elements copied before the throwing one are destroyed, and the storage released
+					Assert::ExpectException<std::runtime_error>([&]() { utils::container::tracked_vector<Throwing> copy{vec}; });
+					Assert::AreEqual(alive, 10);
+					}
+				Assert::AreEqual(alive, 0);
+				}
+
+			TEST_METHOD(slot_map_handles)
+				{
+				utils::container::slot_map<SomeClass> map;
+				std::vector<utils::container::slot_map<SomeClass>::handle> handles;
+				for (int i = 0; i < 100; i++) { handles.push_back(map.emplace(i)); }
+
+				//Erasing relocates the last element, handles follow it
+				Assert::IsTrue(map.erase(handles[10]));
+				Assert::IsFalse(map.erase(handles[10]));
+				Assert::IsFalse(map.contains(handles[10]));
+				Assert::IsTrue(map.get(handles[10]) == nullptr);
+				Assert::AreEqual(map[handles[99]].n, 99);
+				Assert::IsTrue(&map[handles[99]] == &*(map.begin() + 10));
+				Assert::IsTrue(map.handle_of(map.begin() + 10) == handles[99]);
+
+				//The freed slot is reused with a new generation
+				auto reused{map.emplace(1000)};
+				Assert::IsFalse(reused == handles[10]);
+				Assert::IsFalse(map.contains(handles[10]));
+				Assert::AreEqual(map.at(reused).n, 1000);
+
+				Assert::IsFalse(map.contains({}));
+				Assert::ExpectException<std::out_of_range>([&] { map.at(handles[10]); });
+
+				map.clear();
+				Assert::IsTrue(map.empty());
+				Assert::IsFalse(map.contains(handles[0]));
+				Assert::IsFalse(map.contains(reused));
+				}
+
+			TEST_METHOD(concurrent_readers_during_relocation)
+				{
+				std::vector<ConcurrentWrappedClass> vec;
+				for (int i = 0; i < 100; i++) { vec.emplace_back(i); }
+
+				std::vector<utils::tracking_ptr<SomeClass, utils::concurrent_tracking_policy>> ptrs;
+				for (auto& element : vec) { ptrs.emplace_back(element); }
+
+				std::atomic<bool> done{false};
+				std::atomic<bool> mismatch{false};
+				std::thread reader{[&]
+					{
+					while (!done)
+						{
+						for (int i = 0; i < 100; i++)
+							{
+							auto pinned{ptrs[i].pin()};
+							if (pinned && pinned->n != i) { mismatch = true; }
+							}
+						}
+					}};
+
+				//Grow and compact storage while the reader follows the elements
+				for (int round = 0; round < 200; round++)
+					{
+					for (int i = 0; i < 100; i++) { vec.emplace_back(-1); }
+					vec.erase(vec.begin() + 100, vec.end());
+					vec.shrink_to_fit();
+					}
+				vec.erase(vec.begin(), vec.begin() + 50);
+
+				done = true;
+				reader.join();
+				Assert::IsFalse(mismatch.load());
+				Assert::IsFalse(static_cast<bool>(ptrs[0].pin()));
+				Assert::AreEqual(ptrs[99].pin()->n, 99);
+				}
 		};
 	}
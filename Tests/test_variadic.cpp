@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <utils/variadic.h>
+
+namespace
+	{
+	struct Base {};
+	struct Derived : Base {};
+
+	namespace variadic = utils::variadic;
+	using list = variadic::type_list<int, float, Derived, int, char, float>;
+
+	static_assert( variadic::contains_type_v<float, int, float>);
+	static_assert(!variadic::contains_type_v<double, int, float>);
+	static_assert(!variadic::contains_type_v<double>);
+	static_assert( variadic::contains_value<int, 3, 1, 2, 3>::value);
+	static_assert(!variadic::contains_value<int, 4, 1, 2, 3>::value);
+
+	static_assert(variadic::index_of<float, int, float, float> == 1);
+	static_assert(variadic::index_of<double, int, float> == 2);
+	static_assert(variadic::index_of_derived<Base, int, Derived, Base> == 1);
+
+	static_assert(list::size == 6);
+	static_assert(list::contains<char>);
+	static_assert(list::index_of<char> == 4);
+	static_assert(std::is_same_v<list::at<2>, Derived>);
+	static_assert(std::is_same_v<list::apply<std::tuple>, std::tuple<int, float, Derived, int, char, float>>);
+
+	static_assert(std::is_same_v<variadic::filter<std::is_arithmetic, list>, variadic::type_list<int, float, int, char, float>>);
+	static_assert(std::is_same_v<variadic::filter<std::is_class, list>, variadic::type_list<Derived>>);
+	static_assert(std::is_same_v<variadic::unique<list>, variadic::type_list<int, float, Derived, char>>);
+	static_assert(std::is_same_v<variadic::unique<variadic::type_list<>>, variadic::type_list<>>);
+	}
+
+namespace Tests
+	{
+	TEST_CLASS(Variadic)
+		{
+		public:
+
+			// The checks are static_asserts, this only makes the test appear in the list.
+			TEST_METHOD(type_lists)
+				{
+				Assert::AreEqual(variadic::index_of<char, int, char>, size_t{1});
+				}
+		};
+	}
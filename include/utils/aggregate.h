@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <array>
+
+namespace utils::aggregate
+	{
+	namespace _
+		{
+		// Converts to anything; used to probe how many initializers an aggregate accepts.
+		struct any_field
+			{
+			template <typename T>
+			constexpr operator T() const noexcept;
+			};
+
+		inline constexpr size_t max_fields{16};
+
+		// Stops probing past max_fields, large aggregates like std::array would otherwise instantiate one step per element.
+		// Initializers are spread over the elements of C array members by brace elision, so those count once per element.
+		template <typename T, typename ...Fields>
+		constexpr size_t count_fields() noexcept
+			{
+			if constexpr (sizeof...(Fields) > max_fields) { return sizeof...(Fields); }
+			else if constexpr (requires { T{std::declval<Fields>()..., std::declval<any_field>()}; }) { return count_fields<T, Fields..., any_field>(); }
+			else { return sizeof...(Fields); }
+			}
+
+		// A braced initializer always initializes a whole member, so unlike count_fields this counts C array members once.
+		// Members which can't be copy-list-initialized from {} (i.e. no default constructor) stop the count, making the aggregate not reflectable.
+		template <typename T>
+		constexpr size_t count_members() noexcept
+			{
+			     if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 16; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 15; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 14; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 13; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 12; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 11; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return 10; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}, {}}; }) { return  9; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}, {}}; }) { return  8; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}, {}}; }) { return  7; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}, {}}; }) { return  6; }
+			else if constexpr (requires { T{{}, {}, {}, {}, {}}; }) { return  5; }
+			else if constexpr (requires { T{{}, {}, {}, {}}; }) { return  4; }
+			else if constexpr (requires { T{{}, {}, {}}; }) { return  3; }
+			else if constexpr (requires { T{{}, {}}; }) { return  2; }
+			else if constexpr (requires { T{{}}; }) { return  1; }
+			else { return 0; }
+			}
+
+		// Converts to the bases of T only: T accepts it as its first initializer only if T has a base class.
+		template <typename T>
+		struct any_base
+			{
+			template <typename U>
+				requires (std::is_base_of_v<U, T> && !std::is_same_v<U, T>)
+			constexpr operator U() const noexcept;
+			};
+
+		template <typename T>
+		concept has_bases = requires { T{std::declval<any_base<T>>()}; };
+		}
+
+	// Aggregates whose fields can be decomposed through structured bindings.
+	// Limitations: no base classes, no C array members, default constructible fields, at most 16 fields.
+	// Bit-field members can't be detected; they can be read (for_each_field on a const object, field_t) but not tied.
+	template <typename T>
+	concept reflectable = std::is_class_v<T> && std::is_aggregate_v<T> && !_::has_bases<T> && (_::count_fields<T>() <= _::max_fields) && (_::count_fields<T>() == _::count_members<T>());
+
+	template <reflectable T>
+	inline constexpr size_t field_count{_::count_fields<std::remove_cv_t<T>>()};
+
+	namespace _
+		{
+		// Calls visitor with every field of object as separate arguments.
+		template <typename T, typename Visitor>
+		constexpr decltype(auto) visit_fields(T& object, Visitor visitor)
+			{
+			constexpr size_t count = field_count<std::remove_cv_t<T>>;
+
+			     if constexpr (count ==  0) { return visitor(); }
+			else if constexpr (count ==  1) { auto& [a] = object; return visitor(a); }
+			else if constexpr (count ==  2) { auto& [a, b] = object; return visitor(a, b); }
+			else if constexpr (count ==  3) { auto& [a, b, c] = object; return visitor(a, b, c); }
+			else if constexpr (count ==  4) { auto& [a, b, c, d] = object; return visitor(a, b, c, d); }
+			else if constexpr (count ==  5) { auto& [a, b, c, d, e] = object; return visitor(a, b, c, d, e); }
+			else if constexpr (count ==  6) { auto& [a, b, c, d, e, f] = object; return visitor(a, b, c, d, e, f); }
+			else if constexpr (count ==  7) { auto& [a, b, c, d, e, f, g] = object; return visitor(a, b, c, d, e, f, g); }
+			else if constexpr (count ==  8) { auto& [a, b, c, d, e, f, g, h] = object; return visitor(a, b, c, d, e, f, g, h); }
+			else if constexpr (count ==  9) { auto& [a, b, c, d, e, f, g, h, i] = object; return visitor(a, b, c, d, e, f, g, h, i); }
+			else if constexpr (count == 10) { auto& [a, b, c, d, e, f, g, h, i, j] = object; return visitor(a, b, c, d, e, f, g, h, i, j); }
+			else if constexpr (count == 11) { auto& [a, b, c, d, e, f, g, h, i, j, k] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k); }
+			else if constexpr (count == 12) { auto& [a, b, c, d, e, f, g, h, i, j, k, l] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k, l); }
+			else if constexpr (count == 13) { auto& [a, b, c, d, e, f, g, h, i, j, k, l, m] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k, l, m); }
+			else if constexpr (count == 14) { auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k, l, m, n); }
+			else if constexpr (count == 15) { auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o); }
+			else if constexpr (count == 16) { auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p] = object; return visitor(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p); }
+			}
+
+		struct field_types
+			{
+			template <typename ...Fields>
+			constexpr std::type_identity<std::tuple<std::remove_cvref_t<Fields>...>> operator()(const Fields& ...) const noexcept { return {}; }
+			};
+		}
+
+	// Returns a tuple of references to the fields of an aggregate, in declaration order.
+	template <typename T>
+		requires reflectable<std::remove_cv_t<T>>
+	constexpr auto tie(T& object) noexcept
+		{
+		return _::visit_fields(object, [](auto& ...fields) { return std::tie(fields...); });
+		}
+
+	template <typename T, typename Function>
+		requires reflectable<std::remove_cv_t<T>>
+	constexpr void for_each_field(T& object, Function function)
+		{
+		//Const references can bind to bit-fields, through a temporary
+		if constexpr (std::is_const_v<T>) { _::visit_fields(object, [&](const auto& ...fields) { (..., function(fields)); }); }
+		else { _::visit_fields(object, [&](auto& ...fields) { (..., function(fields)); }); }
+		}
+
+	// Type of the index-th field, without references and cv qualifiers.
+	template <reflectable T, size_t index>
+	using field_t = std::tuple_element_t<index, typename decltype(_::visit_fields(std::declval<const T&>(), _::field_types{}))::type>;
+
+	namespace _
+		{
+		template <typename T>
+		inline constexpr bool is_std_array{false};
+		template <typename T, size_t size>
+		inline constexpr bool is_std_array<std::array<T, size>>{true};
+
+		template <typename T>
+		constexpr bool is_padding_free() noexcept;
+
+		template <typename T, size_t ...indices>
+		constexpr bool fields_padding_free(std::index_sequence<indices...>) noexcept
+			{
+			return ((sizeof(field_t<T, indices>) + ... + 0) == sizeof(T)) && (is_padding_free<field_t<T, indices>>() && ...);
+			}
+
+		template <typename T>
+		constexpr bool is_padding_free() noexcept
+			{
+			if constexpr (std::is_scalar_v<T>) { return true; }
+			else if constexpr (is_std_array<T>) { return sizeof(T) == std::tuple_size_v<T> * sizeof(typename T::value_type) && is_padding_free<typename T::value_type>(); }
+			else if constexpr (reflectable<T>) { return fields_padding_free<T>(std::make_index_sequence<field_count<T>>{}); }
+			else { return std::has_unique_object_representations_v<T>; }
+			}
+		}
+
+	// True when every byte of T belongs to some field, recursively; such types can be copied as a single block without leaking padding.
+	template <typename T>
+	inline constexpr bool is_padding_free{_::is_padding_free<std::remove_cv_t<T>>()};
+	}
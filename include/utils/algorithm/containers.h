@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+#include <utility>
+#include <concepts>
+
 namespace utils::algorithm
 	{
 	template <class Bidirectional_iterator, class Unary_predicate>
@@ -31,4 +35,35 @@ namespace utils::algorithm
 			}
 		return current;
 		}
+	
+	// Erases the elements matching predicate by moving the last kept elements into their place, then erasing the tail in one go.
+	// predicate sees every element before anything moves, so it may rely on element addresses. Doesn't preserve order. Returns the erased count.
+	// Containers with their own erase_if (i.e. utils::container::slot_map, which must keep its handles up to date) are left to it.
+	template <class Container, class Unary_predicate>
+	size_t unordered_erase_if(Container& container, Unary_predicate predicate)
+		{
+		if constexpr (requires { { container.erase_if(predicate) } -> std::convertible_to<size_t>; }) { return container.erase_if(predicate); }
+		else
+			{
+			std::vector<bool> erase;
+			erase.reserve(container.size());
+			for (auto&& element : container) { erase.push_back(predicate(element)); }
+
+			auto current = container.begin();
+			auto last = container.end();
+			size_t kept_end = erase.size();
+
+			for (size_t i = 0; i < kept_end; i++, current++)
+				{
+				if (!erase[i]) { continue; }
+				do { last--; kept_end--; } while (kept_end > i && erase[kept_end]);
+				if (kept_end > i) { *current = std::move(*last); }
+				}
+
+			const size_t erased = erase.size() - kept_end;
+			if constexpr (requires { container.erase(last, container.end()); }) { container.erase(last, container.end()); }
+			else { for (size_t i = 0; i < erased; i++) { container.pop_back(); } }
+			return erased;
+			}
+		}
 	}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__) || (defined(_MSC_VER) && defined(__AVX__))
+	#include <nmmintrin.h>
+	#define utils_checksum_crc32c_sse42
+#elif defined(__ARM_FEATURE_CRC32)
+	#include <arm_acle.h>
+	#define utils_checksum_crc32c_arm
+#endif
+
+namespace utils::checksum
+	{
+	// Checksum that does nothing, for containers where checksumming is optional.
+	struct none
+		{
+		using value_type = void;
+		void update(const std::byte*, size_t) noexcept {}
+		void reset() noexcept {}
+		};
+
+	// CRC-32C (Castagnoli). Uses the SSE 4.2 or ARMv8 CRC instructions when the target enables them, a lookup table otherwise.
+	class crc32c
+		{
+		public:
+			using value_type = uint32_t;
+
+			void update(const std::byte* bytes, size_t count) noexcept
+				{
+#if defined(utils_checksum_crc32c_sse42) && (defined(__x86_64__) || defined(_M_X64))
+				for (; count >= sizeof(uint64_t); bytes += sizeof(uint64_t), count -= sizeof(uint64_t))
+					{
+					uint64_t word; std::memcpy(&word, bytes, sizeof(uint64_t));
+					state = static_cast<uint32_t>(_mm_crc32_u64(state, word));
+					}
+				for (; count; bytes++, count--) { state = _mm_crc32_u8(state, static_cast<uint8_t>(*bytes)); }
+#elif defined(utils_checksum_crc32c_sse42)
+				for (; count >= sizeof(uint32_t); bytes += sizeof(uint32_t), count -= sizeof(uint32_t))
+					{
+					uint32_t word; std::memcpy(&word, bytes, sizeof(uint32_t));
+					state = _mm_crc32_u32(state, word);
+					}
+				for (; count; bytes++, count--) { state = _mm_crc32_u8(state, static_cast<uint8_t>(*bytes)); }
+#elif defined(utils_checksum_crc32c_arm)
+				for (; count >= sizeof(uint64_t); bytes += sizeof(uint64_t), count -= sizeof(uint64_t))
+					{
+					uint64_t word; std::memcpy(&word, bytes, sizeof(uint64_t));
+					state = __crc32cd(state, word);
+					}
+				for (; count; bytes++, count--) { state = __crc32cb(state, static_cast<uint8_t>(*bytes)); }
+#else
+				for (; count; bytes++, count--) { state = table[(state ^ static_cast<uint8_t>(*bytes)) & 0xFF] ^ (state >> 8); }
+#endif
+				}
+
+			value_type value() const noexcept { return ~state; }
+			void reset() noexcept { state = initial_state; }
+
+		private:
+			inline static constexpr uint32_t initial_state{0xFFFFFFFF};
+			inline static constexpr uint32_t polynomial{0x82F63B78}; //reflected
+
+			inline static constexpr std::array<uint32_t, 256> table{[]
+				{
+				std::array<uint32_t, 256> ret{};
+				for (uint32_t i = 0; i < 256; i++)
+					{
+					uint32_t crc{i};
+					for (size_t bit = 0; bit < 8; bit++) { crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1; }
+					ret[i] = crc;
+					}
+				return ret;
+				}()};
+
+			uint32_t state{initial_state};
+		};
+	}
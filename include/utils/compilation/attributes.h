@@ -0,0 +1,8 @@
+#pragma once
+
+// MSVC accepts [[no_unique_address]] but ignores it, empty members only take no space with its own attribute.
+#ifdef _MSC_VER
+	#define utils_no_unique_address [[msvc::no_unique_address]]
+#else
+	#define utils_no_unique_address [[no_unique_address]]
+#endif
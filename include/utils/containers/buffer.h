@@ -1,74 +1,479 @@
+#pragma once
+
 #include <vector>
 #include <deque>
 #include <stdexcept>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <array>
+#include <bit>
 #include <concepts>
 #include <string>
+#include <algorithm>
+#include <optional>
+#include <system_error>
+
+#if __has_include(<sys/uio.h>)
+	#include <sys/uio.h>
+	#include <unistd.h>
+	#include <climits>
+	#include <cerrno>
+	#define utils_buffer_has_fd_io
+#endif
 
 #include "../compilation/debug.h"
+#include "../aggregate.h"
+#include "../checksum.h"
+#include "chunk_pool.h"
 
 namespace utils::container
 	{
-	class buffer
+	namespace _
+		{
+		template <typename T>
+		T byteswap(T value) noexcept
+			{
+			std::array<std::byte, sizeof(T)> bytes;
+			std::memcpy(bytes.data(), std::addressof(value), sizeof(T));
+			std::reverse(bytes.begin(), bytes.end());
+			std::memcpy(std::addressof(value), bytes.data(), sizeof(T));
+			return value;
+			}
+
+		template <typename T>
+		struct is_std_array : std::false_type {};
+		template <typename T, size_t size>
+		struct is_std_array<std::array<T, size>> : std::true_type {};
+
+		// Inherited rather than held, so an unchecked buffer gets the empty base optimization, which MSVC doesn't apply to [[no_unique_address]] members.
+		template <typename Checksum>
+		struct checksum_state
+			{
+			Checksum write_checksum;
+			Checksum read_checksum;
+			};
+		template <>
+		struct checksum_state<checksum::none> {};
+		}
+
+	namespace buffer_storage
+		{
+		// Single double-ended queue of bytes.
+		class deque
+			{
+			// Left uninitialized when default constructed, so growing the queue to receive data doesn't clear it first.
+			struct uninitialized_byte
+				{
+				std::byte value;
+				uninitialized_byte() noexcept {}
+				uninitialized_byte(std::byte value) noexcept : value{value} {}
+				operator std::byte() const noexcept { return value; }
+				};
+
+			public:
+				bool empty() const noexcept { return data.empty(); }
+				size_t size() const noexcept { return data.size(); }
+
+				void append(const std::byte* bytes, size_t count) { data.insert(data.end(), bytes, bytes + count); }
+				void consume(std::byte* bytes, size_t count) noexcept
+					{
+					std::copy_n(data.begin(), count, bytes);
+					discard(count);
+					}
+				void discard(size_t count) noexcept { data.erase(data.begin(), data.begin() + count); }
+				void peek(size_t offset, std::byte* bytes, size_t count) const noexcept { std::copy_n(data.begin() + offset, count, bytes); }
+				// New bytes are left uninitialized.
+				void resize(size_t size) { data.resize(size); }
+
+				// Calls function with each contiguous run of memory between begin and end, until it returns false.
+				template <typename Function>
+				void for_each_segment(size_t begin, size_t end, Function function)
+					{
+					auto it{data.begin() + begin};
+					const auto it_end{data.begin() + end};
+					while (it != it_end)
+						{
+						std::byte* run_begin{&it->value};
+						size_t run_size{1};
+						for (++it; it != it_end && &it->value == run_begin + run_size; ++it) { run_size++; }
+
+						if (!function(run_begin, run_size)) { return; }
+						}
+					}
+
+			private:
+				std::deque<uninitialized_byte> data;
+			};
+
+		// Fixed-size chunks drawn from a chunk_pool. Growing never moves stored bytes, and consumed chunks go back to the pool for other buffers to reuse.
+		template <size_t chunk_size = 64 * 1024>
+		class chunked
+			{
+			static_assert(std::has_single_bit(chunk_size), "Chunk size must be a power of two.");
+
+			public:
+				using pool_t = chunk_pool<chunk_size>;
+
+				chunked(pool_t& pool = pool_t::global()) noexcept : pool{&pool} {}
+				chunked(const chunked& copy) : pool{copy.pool} { copy_from(copy); }
+				chunked& operator=(const chunked& copy) 
+					{
+					if (this != &copy) { clear(); copy_from(copy); }
+					return *this;
+					}
+				chunked(chunked&& move) noexcept : pool{move.pool}, chunks{std::move(move.chunks)}, head{move.head}, _size{move._size} { move.head = 0; move._size = 0; }
+				chunked& operator=(chunked&& move) noexcept 
+					{
+					clear();
+					pool = move.pool; chunks = std::move(move.chunks); head = move.head; _size = move._size;
+					move.head = 0; move._size = 0;
+					return *this;
+					}
+				~chunked() noexcept { clear(); }
+
+				bool empty() const noexcept { return !_size; }
+				size_t size() const noexcept { return _size; }
+
+				void append(const std::byte* bytes, size_t count)
+					{
+					size_t end{head + _size};
+					reserve_until(end + count);
+					while (count)
+						{
+						const size_t step{std::min(count, chunk_size - (end % chunk_size))};
+						std::memcpy(address(end), bytes, step);
+						bytes += step; count -= step; end += step; _size += step;
+						}
+					}
+				void consume(std::byte* bytes, size_t count) noexcept
+					{
+					peek(0, bytes, count);
+					discard(count);
+					}
+				void discard(size_t count) noexcept
+					{
+					head += count;
+					_size -= count;
+					for (; head >= chunk_size; head -= chunk_size) { pool->release(std::move(chunks.front())); chunks.pop_front(); }
+					if (!_size) { head = 0; } //reuse the remaining chunk from its beginning
+					}
+				void peek(size_t offset, std::byte* bytes, size_t count) const noexcept
+					{
+					for (size_t position{head + offset}; count;)
+						{
+						const size_t step{std::min(count, chunk_size - (position % chunk_size))};
+						std::memcpy(bytes, address(position), step);
+						bytes += step; count -= step; position += step;
+						}
+					}
+				void resize(size_t size)
+					{
+					reserve_until(head + size);
+					_size = size;
+					while (chunks.size() > chunks_until(head + _size)) { pool->release(std::move(chunks.back())); chunks.pop_back(); }
+					}
+
+				template <typename Function>
+				void for_each_segment(size_t begin, size_t end, Function function)
+					{
+					for (size_t position{head + begin}, last{head + end}; position != last;)
+						{
+						const size_t step{std::min(last - position, chunk_size - (position % chunk_size))};
+						if (!function(address(position), step)) { return; }
+						position += step;
+						}
+					}
+
+			private:
+				pool_t* pool;
+				std::deque<typename pool_t::chunk_ptr> chunks;
+				size_t head{0};
+				size_t _size{0};
+
+				static size_t chunks_until(size_t position) noexcept { return (position + chunk_size - 1) / chunk_size; }
+				std::byte* address(size_t position) const noexcept { return chunks[position / chunk_size]->data() + (position % chunk_size); }
+
+				void reserve_until(size_t position) { while (chunks.size() < chunks_until(position)) { chunks.push_back(pool->acquire()); } }
+
+				void clear() noexcept
+					{
+					for (auto& chunk : chunks) { pool->release(std::move(chunk)); }
+					chunks.clear();
+					head = 0;
+					_size = 0;
+					}
+				void copy_from(const chunked& copy)
+					{
+					for (size_t position{copy.head}, last{copy.head + copy._size}; position != last;)
+						{
+						const size_t step{std::min(last - position, chunk_size - (position % chunk_size))};
+						append(copy.address(position), step);
+						position += step;
+						}
+					}
+			};
+		}
+
+	// Values are written in the given byte order. With the native byte order (the default) values are copied as they are in memory;
+	// with a fixed byte order every scalar is converted on push and get, which compiles out entirely when it matches the host.
+	// Checksum is updated with every byte as it is pushed and as it is read back, see push_checksum and get_checksum.
+	// Storage holds the bytes, see buffer_storage.
+	template <std::endian wire_endianness = std::endian::native, typename Checksum = checksum::none, typename Storage = buffer_storage::deque>
+	class basic_buffer : private _::checksum_state<Checksum>
 		{
 		public:
+			inline static constexpr std::array<std::byte, 4> header_magic{std::byte{'U'}, std::byte{'T'}, std::byte{'B'}, std::byte{'F'}};
+			inline static constexpr bool swaps_bytes{wire_endianness != std::endian::native};
 
+			// Values pushed as raw bytes. Aggregates qualify only when padding-free; padded ones are written field by field instead, so no padding reaches the stream.
+			// When bytes must be swapped only single-byte scalars can be copied as they are.
 			template <typename T>
-			void push(T value) noexcept
-				{
-				static_assert(std::is_trivially_copyable<T>::value);
-				std::byte* to_push = reinterpret_cast<std::byte*>(&value);
-				for (size_t i = 0; i < sizeof(T); i++) { data.push_back(to_push[i]); }
-				}
+			static constexpr bool is_block_copyable{swaps_bytes ? (std::is_scalar_v<T> && sizeof(T) == 1) : (std::is_trivially_copyable_v<T> && (!aggregate::reflectable<T> || aggregate::is_padding_free<T>))};
 
-			template <>
-			void push<std::string>(std::string value) noexcept
-				/*template <typename T>
-				void push<std::basic_string<T>>(T value) noexcept*/
+			template <typename T>
+			void push(const T& value) noexcept
 				{
-				size_t size = value.size();
-				std::byte* to_size = reinterpret_cast<std::byte*>(size);
-				for (size_t i = 0; i < sizeof(decltype(size)); i++) 
-					{ data.push_back(to_size[i]); }
-
-				/*std::byte* to_push = reinterpret_cast<std::byte*>(value.data());
-				for (size_t i = 0; i < sizeof(to_push); i++) { data.push_back(to_push[i]); }*/
+				if constexpr (std::is_same_v<T, std::string>)
+					{
+					push<uint64_t>(value.size());
+					push_bytes(reinterpret_cast<const std::byte*>(value.data()), value.size());
+					}
+				else if constexpr (is_block_copyable<T>) { push_bytes(reinterpret_cast<const std::byte*>(std::addressof(value)), sizeof(T)); }
+				else if constexpr (swaps_bytes && std::is_scalar_v<T>)
+					{
+					const T swapped{_::byteswap(value)};
+					push_bytes(reinterpret_cast<const std::byte*>(std::addressof(swapped)), sizeof(T));
+					}
+				else if constexpr (_::is_std_array<T>::value) { for (const auto& element : value) { push(element); } }
+				else if constexpr (aggregate::reflectable<T>) { aggregate::for_each_field(value, [this](const auto& field) { push(field); }); }
+				else { static_assert(is_serializable<T>, "Type must be trivially copyable, an std::string or an aggregate of serializable fields. Non-aggregate classes cannot be written with a non-native byte order."); }
 				}
 
 			template <typename T>
 			T get() utils_ifrelease(noexcept)
 				{
-				static_assert(std::is_trivially_copyable<T>());
 				utils_ifdebug(check_bytes_sufficient<T>());
 
-				std::array<std::byte, sizeof(T)> pulled;
-				for (size_t i = 0; i < sizeof(T); i++) { pulled[i] = data.front(); data.pop_front(); }
-
-				//return *reinterpret_cast<T*>(pulled.data()); //bad because the array is not guaranteed to be aligned by T, it is aligned by byte. memcpy copies bytes, solving alignment issues
-				T tmp;
-				std::memcpy(&tmp, pulled.data(), sizeof(T));
-				return tmp;
+				if constexpr (std::is_same_v<T, std::string>)
+					{
+					std::string ret(static_cast<size_t>(get<uint64_t>()), '\0');
+					pull_bytes(reinterpret_cast<std::byte*>(ret.data()), ret.size());
+					return ret;
+					}
+				else if constexpr (is_block_copyable<T>)
+					{
+					//memcpy copies bytes, solving alignment issues of reinterpreting the storage directly
+					T tmp;
+					pull_bytes(reinterpret_cast<std::byte*>(std::addressof(tmp)), sizeof(T));
+					return tmp;
+					}
+				else if constexpr (swaps_bytes && std::is_scalar_v<T>)
+					{
+					T tmp;
+					pull_bytes(reinterpret_cast<std::byte*>(std::addressof(tmp)), sizeof(T));
+					return _::byteswap(tmp);
+					}
+				else if constexpr (_::is_std_array<T>::value)
+					{
+					T ret;
+					for (auto& element : ret) { element = get<typename T::value_type>(); }
+					return ret;
+					}
+				else if constexpr (aggregate::reflectable<T>) { return get_fields<T>(std::make_index_sequence<aggregate::field_count<T>>{}); }
+				else { static_assert(is_serializable<T>, "Type must be trivially copyable, an std::string or an aggregate of serializable fields. Non-aggregate classes cannot be read with a non-native byte order."); }
 				}
 
 			template <typename T>
-			T& get_except()
+			T get_except()
 				{
-				static_assert(std::is_trivially_copyable<T>());
 				check_bytes_sufficient<T>();
 				return get<T>();
 				}
 
 			template <typename T>
-			bool has() const noexcept { return (data.size() >= sizeof(T)); }
+			bool has() const noexcept { size_t offset{0}; return has_at<T>(offset); }
 
 			bool empty() const noexcept { return data.empty(); }
 			size_t size() const noexcept { return data.size(); }
 
+			// Header identifying the format: magic bytes, byte order and a user defined schema version.
+			void push_header(uint32_t schema_version) noexcept
+				{
+				push_bytes(header_magic.data(), header_magic.size());
+				push<uint8_t>(wire_endianness == std::endian::little ? 0 : 1);
+				push(schema_version);
+				}
+
+			// Consumes and validates a header, returning the schema version it was written with.
+			uint32_t get_header()
+				{
+				std::array<std::byte, header_magic.size()> magic;
+				if (data.size() < magic.size()) { throw std::runtime_error{"The stream does not start with a buffer header."}; }
+				data.peek(0, magic.data(), magic.size());
+				if (magic != header_magic) { throw std::runtime_error{"The stream does not start with a buffer header."}; }
+				pull_bytes(magic.data(), magic.size());
+
+				if (get_except<uint8_t>() != (wire_endianness == std::endian::little ? 0 : 1)) { throw std::runtime_error{"The stream was written with a different byte order."}; }
+				return get_except<uint32_t>();
+				}
+
+			// Appends the checksum of everything pushed since the previous checksum.
+			void push_checksum() noexcept requires (!std::is_same_v<Checksum, checksum::none>)
+				{
+				typename Checksum::value_type value{this->write_checksum.value()};
+				if constexpr (swaps_bytes) { value = _::byteswap(value); }
+				data.append(reinterpret_cast<const std::byte*>(&value), sizeof(value));
+				this->write_checksum.reset();
+				}
+
+			// Consumes a checksum written by push_checksum and compares it with the checksum of everything read since the previous one.
+			void get_checksum() requires (!std::is_same_v<Checksum, checksum::none>)
+				{
+				using value_type = typename Checksum::value_type;
+				if (data.size() < sizeof(value_type)) { throw std::runtime_error{"The stream does not contain enough bytes to retrive the checksum"}; }
+
+				value_type value;
+				data.consume(reinterpret_cast<std::byte*>(&value), sizeof(value_type));
+				if constexpr (swaps_bytes) { value = _::byteswap(value); }
+
+				const bool valid{value == this->read_checksum.value()};
+				this->read_checksum.reset();
+				if (!valid) { throw std::runtime_error{"Buffer checksum mismatch, the stream is corrupted."}; }
+				}
+
+#ifdef utils_buffer_has_fd_io
+			// Writes as much of the content as the file descriptor accepts straight from the internal storage with a single writev, consuming what was written.
+			// Returns the amount of bytes written, 0 if the descriptor is non-blocking and not ready. Calls interrupted by a signal are retried.
+			size_t write_to(int fd)
+				{
+				if (data.empty()) { return 0; }
+
+				std::array<iovec, max_iovecs> iovecs;
+				const int iovecs_count{static_cast<int>(gather(0, data.size(), iovecs))};
+				ssize_t written;
+				do { written = ::writev(fd, iovecs.data(), iovecs_count); }
+				while (written < 0 && errno == EINTR);
+
+				if (written < 0)
+					{
+					if (errno == EAGAIN || errno == EWOULDBLOCK) { return 0; }
+					throw std::system_error{errno, std::generic_category(), "Failed to write buffer to file descriptor."};
+					}
+
+				data.discard(static_cast<size_t>(written));
+				return static_cast<size_t>(written);
+				}
+
+			// Appends up to max_bytes read from the file descriptor with a single readv directly into the internal storage.
+			// Returns the amount of bytes read, 0 at end of file, nullopt if the descriptor is non-blocking and has no data ready. Calls interrupted by a signal are retried.
+			// Values can be partially received; has<T>() tells when enough bytes have arrived to get one.
+			std::optional<size_t> read_from(int fd, size_t max_bytes)
+				{
+				//Reading 0 bytes would return 0, which means end of file
+				if (max_bytes == 0) { throw std::runtime_error{"Reading from a file descriptor requires a max_bytes greater than 0."}; }
+
+				const size_t previous_size{data.size()};
+				data.resize(previous_size + max_bytes);
+
+				std::array<iovec, max_iovecs> iovecs;
+				const int iovecs_count{static_cast<int>(gather(previous_size, data.size(), iovecs))};
+				ssize_t received;
+				do { received = ::readv(fd, iovecs.data(), iovecs_count); }
+				while (received < 0 && errno == EINTR);
+				const int error{errno};
+				data.resize(previous_size + (received > 0 ? received : 0));
+
+				if (received < 0)
+					{
+					if (error == EAGAIN || error == EWOULDBLOCK) { return std::nullopt; }
+					throw std::system_error{error, std::generic_category(), "Failed to read buffer from file descriptor."};
+					}
+				return static_cast<size_t>(received);
+				}
+#endif
+
 		private:
-			std::deque<std::byte> data;
+			Storage data;
+
+#ifdef utils_buffer_has_fd_io
+	#ifdef IOV_MAX
+			inline static constexpr size_t max_iovecs{IOV_MAX < 1024 ? IOV_MAX : 1024};
+	#else
+			inline static constexpr size_t max_iovecs{16};
+	#endif
+
+			// Describes the contiguous segments of the storage between begin and end, up to the size of iovecs. Returns how many were filled.
+			size_t gather(size_t begin, size_t end, std::array<iovec, max_iovecs>& iovecs) noexcept
+				{
+				size_t count{0};
+				data.for_each_segment(begin, end, [&](std::byte* segment, size_t size)
+					{
+					iovecs[count++] = {segment, size};
+					return count < iovecs.size();
+					});
+				return count;
+				}
+#endif
 
 			template <typename T>
-			void check_bytes_sufficient() { if (has<T>()) { throw std::runtime_error{"The stream does not contain enough bytes to retrive type T"}; } }
+			static constexpr bool is_serializable{std::is_same_v<T, std::string> || is_block_copyable<T> || std::is_scalar_v<T> || _::is_std_array<T>::value || aggregate::reflectable<T>};
+
+			void push_bytes(const std::byte* bytes, size_t count)
+				{
+				if constexpr (!std::is_same_v<Checksum, checksum::none>) { this->write_checksum.update(bytes, count); }
+				data.append(bytes, count);
+				}
+			void pull_bytes(std::byte* bytes, size_t count)
+				{
+				data.consume(bytes, count);
+				if constexpr (!std::is_same_v<Checksum, checksum::none>) { this->read_checksum.update(bytes, count); }
+				}
+
+			template <typename T, size_t ...indices>
+			T get_fields(std::index_sequence<indices...>)
+				{
+				//Braced initialization evaluates its elements in order
+				return T{get<aggregate::field_t<T, indices>>()...};
+				}
+
+			// Advances offset past a T stored at offset, false if the stored bytes end before it does.
+			template <typename T>
+			bool has_at(size_t& offset) const noexcept
+				{
+				if constexpr (std::is_same_v<T, std::string>)
+					{
+					if (!has_at<uint64_t>(offset)) { return false; }
+					uint64_t length;
+					data.peek(offset - sizeof(uint64_t), reinterpret_cast<std::byte*>(&length), sizeof(uint64_t));
+					if constexpr (swaps_bytes) { length = _::byteswap(length); }
+					//The length comes from the stream, compare before adding so a corrupt one can't wrap around
+					if (length > data.size() - offset) { return false; }
+					offset += length;
+					return true;
+					}
+				else if constexpr (is_block_copyable<T> || std::is_scalar_v<T>) { offset += sizeof(T); return offset <= data.size(); }
+				else if constexpr (_::is_std_array<T>::value)
+					{
+					for (size_t i = 0; i < std::tuple_size_v<T>; i++) { if (!has_at<typename T::value_type>(offset)) { return false; } }
+					return true;
+					}
+				else { return has_fields_at<T>(offset, std::make_index_sequence<aggregate::field_count<T>>{}); }
+				}
+			template <typename T, size_t ...indices>
+			bool has_fields_at(size_t& offset, std::index_sequence<indices...>) const noexcept { return (has_at<aggregate::field_t<T, indices>>(offset) && ...); }
+
+			template <typename T>
+			void check_bytes_sufficient() const { if (!has<T>()) { throw std::runtime_error{"The stream does not contain enough bytes to retrive type T"}; } }
 		};
+
+	using buffer = basic_buffer<>;
+	// Portable wire format, identical to native on little endian hosts.
+	using little_endian_buffer = basic_buffer<std::endian::little>;
+	using checked_buffer = basic_buffer<std::endian::little, checksum::crc32c>;
+	// Grows by pooled chunks instead of reallocating; prefer it for large or long-lived streams.
+	using segmented_buffer = basic_buffer<std::endian::native, checksum::none, buffer_storage::chunked<>>;
+
+	static_assert(sizeof(buffer) == sizeof(buffer_storage::deque), "An unchecked buffer must not pay for the checksum state");
+	static_assert(sizeof(segmented_buffer) == sizeof(buffer_storage::chunked<>), "An unchecked buffer must not pay for the checksum state");
 	}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <cstddef>
+
+namespace utils::container
+	{
+	// Recycles fixed-size blocks of bytes. Chunks released by one user are handed out to the next one, so steady-state growth does not reach the allocator.
+	// Thread safe; users are expected to acquire and release whole chunks, not individual bytes, which keeps the lock out of hot loops.
+	template <size_t chunk_size>
+	class chunk_pool
+		{
+		public:
+			using chunk_t = std::array<std::byte, chunk_size>;
+			using chunk_ptr = std::unique_ptr<chunk_t>;
+
+			// Shared by every user of this chunk size that doesn't provide its own pool.
+			static chunk_pool& global() noexcept { static chunk_pool instance; return instance; }
+
+			chunk_ptr acquire()
+				{
+					{
+					std::scoped_lock lock{mutex};
+					if (!free_chunks.empty())
+						{
+						chunk_ptr ret{std::move(free_chunks.back())};
+						free_chunks.pop_back();
+						return ret;
+						}
+					}
+				return std::make_unique_for_overwrite<chunk_t>();
+				}
+
+			void release(chunk_ptr chunk) noexcept
+				{
+				std::scoped_lock lock{mutex};
+				if (free_chunks.size() < max_free_chunks)
+					{
+					try { free_chunks.push_back(std::move(chunk)); }
+					catch (...) {} //chunk is simply deallocated
+					}
+				}
+
+			// Caps how many unused chunks are kept around, the rest go back to the allocator.
+			void set_max_free_chunks(size_t count) noexcept
+				{
+				std::scoped_lock lock{mutex};
+				max_free_chunks = count;
+				if (free_chunks.size() > max_free_chunks) { free_chunks.resize(max_free_chunks); }
+				}
+
+			size_t free_chunks_count() const noexcept { std::scoped_lock lock{mutex}; return free_chunks.size(); }
+
+		private:
+			mutable std::mutex mutex;
+			std::vector<chunk_ptr> free_chunks;
+			size_t max_free_chunks{std::numeric_limits<size_t>::max()};
+		};
+	}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../compilation/debug.h"
+
+namespace utils::container
+	{
+	// Dense storage of T addressed through generational handles, an alternative to tracking_ptr when the owner of the elements is a container.
+	// Elements are kept contiguous: erasing moves the last element in the erased one's place. Handles survive that relocation,
+	// resolve in O(1) through a slot table, and don't need any per element allocation.
+	// Erasing an element bumps its slot's generation, so old handles to it stop resolving instead of reaching the slot's next occupant.
+	template <typename T>
+	class slot_map
+		{
+		using index_t = uint32_t;
+
+		public:
+			using value_type      = T;
+			using size_type       = size_t;
+			using reference       = value_type&;
+			using const_reference = const value_type&;
+			using iterator        = typename std::vector<T>::iterator;
+			using const_iterator  = typename std::vector<T>::const_iterator;
+
+			// Identifies an element of a slot_map. A default constructed handle never refers to anything.
+			class handle
+				{
+				friend class slot_map;
+				public:
+					handle() noexcept = default;
+					bool operator==(const handle& other) const noexcept = default;
+
+				private:
+					handle(index_t slot, index_t generation) noexcept : slot{slot}, generation{generation} {}
+					index_t slot{0};
+					index_t generation{0};
+				};
+
+			template <typename ...Args>
+			handle emplace(Args&& ...args)
+				{
+				elements.emplace_back(std::forward<Args>(args)...);
+
+				index_t slot_index;
+				if (free_head != npos)
+					{
+					slot_index = free_head;
+					free_head = slots[slot_index].index;
+					}
+				else
+					{
+					slot_index = static_cast<index_t>(slots.size());
+					try { slots.push_back({}); }
+					catch (...) { elements.pop_back(); throw; }
+					}
+
+				try { element_slots.push_back(slot_index); }
+				catch (...) { release_slot(slot_index); elements.pop_back(); throw; }
+
+				slots[slot_index].index = static_cast<index_t>(elements.size() - 1);
+				return {slot_index, slots[slot_index].generation};
+				}
+			handle insert(const T& value) { return emplace(value); }
+			handle insert(T&& value) { return emplace(std::move(value)); }
+
+			// Returns false if the handle didn't refer to an element.
+			bool erase(handle h) noexcept(std::is_nothrow_move_assignable_v<T>)
+				{
+				if (!contains(h)) { return false; }
+
+				const index_t index{slots[h.slot].index};
+				const index_t last{static_cast<index_t>(elements.size() - 1)};
+				if (index != last)
+					{
+					elements[index] = std::move(elements[last]);
+					element_slots[index] = element_slots[last];
+					slots[element_slots[index]].index = index;
+					}
+				elements.pop_back();
+				element_slots.pop_back();
+				release_slot(h.slot);
+				return true;
+				}
+
+			// Erases the elements matching predicate, which sees every element before any is moved. Handles of the kept elements stay valid. Returns the erased count.
+			template <typename Predicate>
+			size_type erase_if(Predicate predicate)
+				{
+				std::vector<handle> erased;
+				for (size_type i = 0; i < elements.size(); i++)
+					{
+					if (predicate(elements[i])) { erased.push_back(handle_at(i)); }
+					}
+				for (handle h : erased) { erase(h); }
+				return erased.size();
+				}
+
+			bool contains(handle h) const noexcept { return h.slot < slots.size() && slots[h.slot].generation == h.generation; }
+
+			// Pointer to the element, nullptr if the handle doesn't refer to one anymore. Valid until the next insertion or erasure.
+			      T* get(handle h)       noexcept { return contains(h) ? &elements[slots[h.slot].index] : nullptr; }
+			const T* get(handle h) const noexcept { return contains(h) ? &elements[slots[h.slot].index] : nullptr; }
+
+			      reference operator[](handle h)       utils_ifrelease(noexcept) { utils_ifdebug(check_contains(h);) return elements[slots[h.slot].index]; }
+			const_reference operator[](handle h) const utils_ifrelease(noexcept) { utils_ifdebug(check_contains(h);) return elements[slots[h.slot].index]; }
+			      reference at(handle h)       { check_contains(h); return elements[slots[h.slot].index]; }
+			const_reference at(handle h) const { check_contains(h); return elements[slots[h.slot].index]; }
+
+			// Handle of the element at the given position of the dense storage, for use while iterating.
+			handle handle_of(const_iterator it) const noexcept { return handle_at(static_cast<size_type>(it - elements.begin())); }
+			// Handle of an element of this slot_map, i.e. the one returned by a container which emplaces into it.
+			handle handle_of(const_reference element) const noexcept { return handle_at(static_cast<size_type>(&element - elements.data())); }
+
+			void clear() noexcept
+				{
+				for (index_t slot : element_slots) { release_slot(slot); }
+				elements.clear();
+				element_slots.clear();
+				}
+
+			void reserve(size_type capacity)
+				{
+				elements.reserve(capacity);
+				element_slots.reserve(capacity);
+				slots.reserve(capacity);
+				}
+
+			      iterator begin()       noexcept { return elements.begin(); }
+			const_iterator begin() const noexcept { return elements.begin(); }
+			      iterator end()         noexcept { return elements.end(); }
+			const_iterator end()   const noexcept { return elements.end(); }
+
+			      T* data()       noexcept { return elements.data(); }
+			const T* data() const noexcept { return elements.data(); }
+
+			size_type size()  const noexcept { return elements.size(); }
+			bool      empty() const noexcept { return elements.empty(); }
+
+		private:
+			inline static constexpr index_t npos{~index_t{0}};
+
+			// index is the element's position in elements while the slot is used, the next free slot otherwise.
+			struct slot_t
+				{
+				index_t index{npos};
+				index_t generation{1};
+				};
+
+			std::vector<T> elements;
+			std::vector<index_t> element_slots; //element_slots[i] is the slot of elements[i]
+			std::vector<slot_t> slots;
+			index_t free_head{npos};
+
+			void release_slot(index_t slot) noexcept
+				{
+				slots[slot].generation++;
+				if (slots[slot].generation == 0) { slots[slot].generation = 1; } //0 is reserved to default constructed handles
+				slots[slot].index = free_head;
+				free_head = slot;
+				}
+
+			handle handle_at(size_type index) const noexcept
+				{
+				const index_t slot{element_slots[index]};
+				return {slot, slots[slot].generation};
+				}
+
+			void check_contains(handle h) const
+				{
+				if (!contains(h)) { throw std::out_of_range{"Trying to access a slot_map element through a handle which element was already erased."}; }
+				}
+		};
+	}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <span>
+#include <tuple>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../aggregate.h"
+
+namespace utils::container
+	{
+	// Sequence of aggregates stored as structure of arrays: each field of T lives in its own contiguous array.
+	// Loops which only touch some fields (for_each<fields...>, column<field>) only load those fields' memory.
+	// Elements are accessed through proxies holding the element's index, so elements are never T& and iterating
+	// requires auto&& (or the proxy type) rather than auto&. Proxies convert to T and can be assigned from T.
+	template <utils::aggregate::reflectable T>
+	class soa_vector
+		{
+		template <size_t field>
+		using field_t = utils::aggregate::field_t<T, field>;
+
+		inline static constexpr size_t fields_count{utils::aggregate::field_count<T>};
+		static_assert(fields_count > 0, "soa_vector requires an aggregate with at least one field.");
+
+		template <typename Indices>
+		struct columns_of;
+		template <size_t ...fields>
+		struct columns_of<std::index_sequence<fields...>>
+			{
+			static_assert((!std::is_same_v<field_t<fields>, bool> && ...), "soa_vector can't store bool fields, std::vector<bool> is packed; use char or an enum.");
+			using type = std::tuple<std::vector<field_t<fields>>...>;
+			};
+
+		using indices_t = std::make_index_sequence<fields_count>;
+		using columns_t = typename columns_of<indices_t>::type;
+
+		public:
+			template <typename Columns>
+			class basic_reference
+				{
+				template <typename>
+				friend class basic_reference;
+				public:
+					basic_reference(Columns& columns, size_t index) noexcept : columns{&columns}, index{index} {}
+					basic_reference(const basic_reference& copy) noexcept = default;
+
+					template <size_t field>
+					auto& get() const noexcept { return std::get<field>(*columns)[index]; }
+
+					operator T() const { return make(indices_t{}); }
+
+					// Assignments write through to the referenced element, field by field.
+					const basic_reference& operator=(const basic_reference& other) const requires (!std::is_const_v<Columns>) { assign(other, indices_t{}); return *this; }
+					const basic_reference& operator=(basic_reference&& other) const requires (!std::is_const_v<Columns>) { move_assign(other, indices_t{}); return *this; }
+					const basic_reference& operator=(const T& value) const requires (!std::is_const_v<Columns>) { assign_fields(utils::aggregate::tie(value), indices_t{}); return *this; }
+					const basic_reference& operator=(T&& value) const requires (!std::is_const_v<Columns>) { move_fields(utils::aggregate::tie(value), indices_t{}); return *this; }
+
+					// Identifies the element, for containers which compare element addresses.
+					const void* address() const noexcept { return &get<0>(); }
+
+				private:
+					Columns* columns;
+					size_t index;
+
+					template <size_t ...fields>
+					T make(std::index_sequence<fields...>) const { return T{get<fields>()...}; }
+					template <typename Other, size_t ...fields>
+					void assign(const Other& other, std::index_sequence<fields...>) const { (..., (get<fields>() = other.template get<fields>())); }
+					template <typename Other, size_t ...fields>
+					void move_assign(const Other& other, std::index_sequence<fields...>) const { (..., (get<fields>() = std::move(other.template get<fields>()))); }
+					template <typename Fields, size_t ...fields>
+					void assign_fields(const Fields& values, std::index_sequence<fields...>) const { (..., (get<fields>() = std::get<fields>(values))); }
+					template <typename Fields, size_t ...fields>
+					void move_fields(const Fields& values, std::index_sequence<fields...>) const { (..., (get<fields>() = std::move(std::get<fields>(values)))); }
+				};
+
+			template <typename Columns>
+			class basic_iterator
+				{
+				friend class soa_vector;
+				template <typename>
+				friend class basic_iterator;
+				public:
+					using iterator_category = std::random_access_iterator_tag;
+					using value_type        = T;
+					using difference_type   = std::ptrdiff_t;
+					using reference         = basic_reference<Columns>;
+					using pointer           = void;
+
+					basic_iterator() = default;
+					basic_iterator(Columns& columns, size_t index) noexcept : columns{&columns}, index{index} {}
+					template <typename Other>
+						requires (std::is_const_v<Columns> && std::is_same_v<Other, std::remove_const_t<Columns>>)
+					basic_iterator(const basic_iterator<Other>& other) noexcept : columns{other.columns}, index{other.index} {}
+
+					reference operator*() const noexcept { return {*columns, index}; }
+					reference operator[](difference_type offset) const noexcept { return {*columns, index + offset}; }
+
+					basic_iterator& operator++() noexcept { index++; return *this; }
+					basic_iterator& operator--() noexcept { index--; return *this; }
+					basic_iterator operator++(int) noexcept { basic_iterator ret{*this}; index++; return ret; }
+					basic_iterator operator--(int) noexcept { basic_iterator ret{*this}; index--; return ret; }
+					basic_iterator& operator+=(difference_type offset) noexcept { index += offset; return *this; }
+					basic_iterator& operator-=(difference_type offset) noexcept { index -= offset; return *this; }
+					basic_iterator operator+(difference_type offset) const noexcept { return {*columns, index + offset}; }
+					basic_iterator operator-(difference_type offset) const noexcept { return {*columns, index - offset}; }
+					friend basic_iterator operator+(difference_type offset, const basic_iterator& iterator) noexcept { return iterator + offset; }
+					difference_type operator-(const basic_iterator& other) const noexcept { return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); }
+
+					bool operator==(const basic_iterator& other) const noexcept { return index == other.index; }
+					auto operator<=>(const basic_iterator& other) const noexcept { return index <=> other.index; }
+
+				private:
+					Columns* columns{nullptr};
+					size_t index{0};
+				};
+
+			using value_type      = T;
+			using size_type       = size_t;
+			using reference       = basic_reference<columns_t>;
+			using const_reference = basic_reference<const columns_t>;
+			using iterator        = basic_iterator<columns_t>;
+			using const_iterator  = basic_iterator<const columns_t>;
+
+			template <typename ...Args>
+			reference emplace_back(Args&& ...args) { return push_back(T{std::forward<Args>(args)...}); }
+			reference push_back(const T& value) { T copy{value}; return push_back(std::move(copy)); }
+			reference push_back(T&& value)
+				{
+				push_fields(utils::aggregate::tie(value), indices_t{});
+				return back();
+				}
+
+			void pop_back() noexcept { for_each_column([](auto& column) { column.pop_back(); }); }
+
+			// Elements after the erased ones are shifted back.
+			iterator erase(const_iterator first, const_iterator last)
+				{
+				for_each_column([&](auto& column) { column.erase(column.begin() + first.index, column.begin() + last.index); });
+				return {columns, first.index};
+				}
+			iterator erase(const_iterator position) { return erase(position, position + 1); }
+
+			void clear() noexcept { for_each_column([](auto& column) { column.clear(); }); }
+			void reserve(size_type capacity) { for_each_column([&](auto& column) { column.reserve(capacity); }); }
+
+			      reference operator[](size_type index)       noexcept { return {columns, index}; }
+			const_reference operator[](size_type index) const noexcept { return {columns, index}; }
+			      reference at(size_type index)       { check_index(index); return {columns, index}; }
+			const_reference at(size_type index) const { check_index(index); return {columns, index}; }
+
+			      reference front()       noexcept { return {columns, 0}; }
+			const_reference front() const noexcept { return {columns, 0}; }
+			      reference back()        noexcept { return {columns, size() - 1}; }
+			const_reference back()  const noexcept { return {columns, size() - 1}; }
+
+			// The contiguous array holding the given field of every element.
+			template <size_t field>
+			std::span<      field_t<field>> column()       noexcept { return std::get<field>(columns); }
+			template <size_t field>
+			std::span<const field_t<field>> column() const noexcept { return std::get<field>(columns); }
+
+			// Calls function with the requested fields of each element, i.e. for_each<0, 2>([](float& x, float& z) { ... }).
+			template <size_t ...fields, typename Function>
+			void for_each(Function function)
+				{
+				const size_type count{size()};
+				const auto data{std::tuple{std::get<fields>(columns).data()...}};
+				for (size_type i = 0; i < count; i++) { std::apply([&](auto* ...field) { function(field[i]...); }, data); }
+				}
+			template <size_t ...fields, typename Function>
+			void for_each(Function function) const
+				{
+				const size_type count{size()};
+				const auto data{std::tuple{std::get<fields>(columns).data()...}};
+				for (size_type i = 0; i < count; i++) { std::apply([&](const auto* ...field) { function(field[i]...); }, data); }
+				}
+
+			      iterator begin()       noexcept { return {columns, 0}; }
+			const_iterator begin() const noexcept { return {columns, 0}; }
+			      iterator end()         noexcept { return {columns, size()}; }
+			const_iterator end()   const noexcept { return {columns, size()}; }
+
+			size_type size()     const noexcept { return std::get<0>(columns).size(); }
+			size_type capacity() const noexcept { return std::get<0>(columns).capacity(); }
+			bool      empty()    const noexcept { return size() == 0; }
+
+		private:
+			columns_t columns;
+
+			template <typename Function>
+			void for_each_column(Function function) { std::apply([&](auto& ...column) { (..., function(column)); }, columns); }
+
+			// Columns pushed before a throwing one are rolled back, so all columns keep the same size.
+			template <typename Fields, size_t ...fields>
+			void push_fields(const Fields& values, std::index_sequence<fields...>)
+				{
+				size_t pushed{0};
+				try { (..., (std::get<fields>(columns).push_back(std::move(std::get<fields>(values))), pushed++)); }
+				catch (...)
+					{
+					(..., (fields < pushed ? std::get<fields>(columns).pop_back() : void()));
+					throw;
+					}
+				}
+
+			void check_index(size_type index) const
+				{
+				if (index >= size()) { throw std::out_of_range{"soa_vector index out of range."}; }
+				}
+		};
+	}
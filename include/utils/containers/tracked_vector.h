@@ -0,0 +1,229 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../tracking.h"
+
+namespace utils::container
+	{
+	// Contiguous storage of plain T, which doesn't need to be trackable, with tracking_ptr support.
+	// Trackers are kept in a separate array parallel to the elements and only exist for elements someone has tracked.
+	// When elements are relocated (growth, erase) they are moved in bulk, memcpy for trivially copyable T, and tracker addresses are rewritten in a single pass afterwards.
+	template <typename T, typename Policy = tracking_policy>
+	class tracked_vector
+		{
+		using tracker_ptr = utils::_::tracker_ptr<T, Policy>;
+		using allocator_traits = std::allocator_traits<std::allocator<T>>;
+		static_assert(!Policy::concurrent, "tracked_vector doesn't support concurrent tracking policies.");
+
+		public:
+			using value_type      = T;
+			using size_type       = size_t;
+			using reference       = value_type&;
+			using const_reference = const value_type&;
+			using pointer         = value_type*;
+			using const_pointer   = const value_type*;
+			using iterator        = pointer;
+			using const_iterator  = const_pointer;
+
+			tracked_vector() = default;
+
+			//Copies are not tracked by the tracking_ptr of the source elements.
+			tracked_vector(const tracked_vector& copy) : trackers(copy._size)
+				{
+				if (!copy._size) { return; }
+
+				//The storage is only adopted once every element is copied, the destructor doesn't run if the constructor throws
+				T* new_elements{allocator_traits::allocate(allocator, copy._size)};
+				size_type constructed{0};
+				try { for (; constructed < copy._size; constructed++) { allocator_traits::construct(allocator, new_elements + constructed, copy.elements[constructed]); } }
+				catch (...)
+					{
+					for (size_type i = 0; i < constructed; i++) { allocator_traits::destroy(allocator, new_elements + i); }
+					allocator_traits::deallocate(allocator, new_elements, copy._size);
+					throw;
+					}
+				elements = new_elements;
+				_size = copy._size;
+				_capacity = copy._size;
+				}
+			tracked_vector& operator=(const tracked_vector& copy)
+				{
+				tracked_vector tmp{copy};
+				swap(tmp);
+				return *this;
+				}
+
+			//The element storage changes owner without being relocated, so trackers stay valid.
+			tracked_vector(tracked_vector&& move) noexcept
+				: elements{std::exchange(move.elements, nullptr)}, _size{std::exchange(move._size, 0)}, _capacity{std::exchange(move._capacity, 0)}, trackers{std::move(move.trackers)} {}
+			tracked_vector& operator=(tracked_vector&& move) noexcept
+				{
+				tracked_vector tmp{std::move(move)};
+				swap(tmp);
+				return *this;
+				}
+
+			~tracked_vector() noexcept
+				{
+				clear();
+				deallocate();
+				}
+
+			void swap(tracked_vector& other) noexcept
+				{
+				std::swap(elements, other.elements);
+				std::swap(_size, other._size);
+				std::swap(_capacity, other._capacity);
+				trackers.swap(other.trackers);
+				}
+
+			// A tracking_ptr following the index-th element through relocations, until it's erased or the vector is destroyed.
+			tracking_ptr<T, Policy> track(size_type index)
+				{
+				tracker_ptr& tracker{trackers[index]};
+				if (!tracker) { tracker = utils::_::make_tracker<T, Policy>(elements + index); }
+				return tracking_ptr<T, Policy>{tracker};
+				}
+
+			template <typename ...Args>
+			reference emplace_back(Args&& ...args)
+				{
+				trackers.emplace_back(nullptr);
+				if (_size < _capacity)
+					{
+					try { allocator_traits::construct(allocator, elements + _size, std::forward<Args>(args)...); }
+					catch (...) { trackers.pop_back(); throw; }
+					}
+				else
+					{
+					//Construct first, args may refer to an element about to be relocated
+					const size_type new_capacity{grown_capacity(_size + 1)};
+					T* new_elements{allocator_traits::allocate(allocator, new_capacity)};
+					try { allocator_traits::construct(allocator, new_elements + _size, std::forward<Args>(args)...); }
+					catch (...) { allocator_traits::deallocate(allocator, new_elements, new_capacity); trackers.pop_back(); throw; }
+					relocate_to(new_elements, new_capacity);
+					}
+				return elements[_size++];
+				}
+			void push_back(const T& value) { emplace_back(value); }
+			void push_back(T&& value) { emplace_back(std::move(value)); }
+
+			void reserve(size_type new_capacity)
+				{
+				if (new_capacity <= _capacity) { return; }
+				relocate_to(allocator_traits::allocate(allocator, new_capacity), new_capacity);
+				trackers.reserve(new_capacity);
+				}
+
+			void pop_back() noexcept
+				{
+				untrack(_size - 1);
+				allocator_traits::destroy(allocator, elements + _size - 1);
+				trackers.pop_back();
+				_size--;
+				}
+
+			// Elements after the erased one are shifted back; their tracking_ptr follow them.
+			iterator erase(const_iterator position)
+				{
+				const size_type index{static_cast<size_type>(position - elements)};
+				untrack(index);
+				std::move(elements + index + 1, elements + _size, elements + index);
+				allocator_traits::destroy(allocator, elements + _size - 1);
+				trackers.erase(trackers.begin() + index);
+				_size--;
+				retarget(index);
+				return elements + index;
+				}
+
+			void clear() noexcept
+				{
+				for (size_type i = 0; i < _size; i++)
+					{
+					untrack(i);
+					allocator_traits::destroy(allocator, elements + i);
+					}
+				trackers.clear();
+				_size = 0;
+				}
+
+			      reference operator[](size_type index)       noexcept { return elements[index]; }
+			const_reference operator[](size_type index) const noexcept { return elements[index]; }
+			      reference at(size_type index)       { check_index(index); return elements[index]; }
+			const_reference at(size_type index) const { check_index(index); return elements[index]; }
+
+			      reference front()       noexcept { return elements[0]; }
+			const_reference front() const noexcept { return elements[0]; }
+			      reference back()        noexcept { return elements[_size - 1]; }
+			const_reference back()  const noexcept { return elements[_size - 1]; }
+
+			      pointer data()       noexcept { return elements; }
+			const_pointer data() const noexcept { return elements; }
+
+			      iterator begin()       noexcept { return elements; }
+			const_iterator begin() const noexcept { return elements; }
+			      iterator end()         noexcept { return elements + _size; }
+			const_iterator end()   const noexcept { return elements + _size; }
+
+			size_type size()     const noexcept { return _size; }
+			size_type capacity() const noexcept { return _capacity; }
+			bool      empty()    const noexcept { return _size == 0; }
+
+		private:
+			[[no_unique_address]] std::allocator<T> allocator;
+			T* elements{nullptr};
+			size_type _size{0};
+			size_type _capacity{0};
+			std::vector<tracker_ptr> trackers; //trackers[i] tracks elements[i], null if nobody ever tracked it
+
+			inline static constexpr bool memcpy_relocatable{std::is_trivially_copyable_v<T>};
+
+			size_type grown_capacity(size_type min_capacity) const noexcept { return std::max(min_capacity, _capacity ? _capacity * 2 : size_type{8}); }
+
+			// Moves all elements to new storage, then rewrites every tracker in one pass.
+			void relocate_to(T* new_elements, size_type new_capacity) noexcept
+				{
+				static_assert(memcpy_relocatable || std::is_nothrow_move_constructible_v<T>, "tracked_vector requires T to be nothrow move constructible.");
+				if (_size)
+					{
+					if constexpr (memcpy_relocatable) { std::memcpy(static_cast<void*>(new_elements), elements, _size * sizeof(T)); }
+					else
+						{
+						std::uninitialized_move(elements, elements + _size, new_elements);
+						std::destroy(elements, elements + _size);
+						}
+					}
+				deallocate();
+				elements = new_elements;
+				_capacity = new_capacity;
+				retarget(0);
+				}
+
+			void retarget(size_type from) noexcept
+				{
+				for (size_type i = from; i < _size; i++) { if (trackers[i]) { trackers[i]->tracked = elements + i; } }
+				}
+
+			void untrack(size_type index) noexcept
+				{
+				if (trackers[index]) { trackers[index]->tracked = nullptr; }
+				}
+
+			void deallocate() noexcept
+				{
+				if (elements) { allocator_traits::deallocate(allocator, elements, _capacity); }
+				}
+
+			void check_index(size_type index) const
+				{
+				if (index >= _size) { throw std::out_of_range{"tracked_vector index out of range."}; }
+				}
+		};
+	}
@@ -21,12 +21,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define ISOCPP_P0201_POLYMORPHIC_VALUE_H_INCLUDED
 
 #include <cassert>
+#include <cstddef>
 #include <exception>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
 
+#include "compilation/attributes.h"
+
 namespace utils
 	{
 
@@ -49,77 +53,190 @@ namespace utils
 			void operator()(const T* t) const { delete t; }
 			};
 
-		template <class T>
-		struct control_block
+		struct heap_ops;
+
+		// Every heap block starts with its table, so polymorphic_value only keeps the block next to the cached object pointer.
+		struct heap_block
 			{
-			virtual ~control_block() = default;
+			const heap_ops* ops;
 
-			virtual std::unique_ptr<control_block> clone() const = 0;
+			explicit heap_block(const heap_ops& ops) noexcept : ops(&ops) {}
+			};
 
-			virtual T* ptr() = 0;
+		// Clone and destroy for a heap block which type was erased. A block holds the most derived object, possibly along with how to copy, delete or allocate it.
+		// polymorphic_value caches the object pointer, so neither dereference nor conversion go through the table.
+		struct heap_ops
+			{
+			heap_block* (*clone)(const heap_block* block);
+			void (*destroy)(heap_block* block) noexcept;
+			// The most derived object held by the block.
+			void* (*object)(heap_block* block) noexcept;
 			};
 
-		template <class T, class U = T>
-		class direct_control_block : public control_block<T>
+		template <class U>
+		struct direct_block : heap_block
 			{
-			static_assert(!std::is_reference<U>::value, "");
-			U u_;
+			U u;
 
-			public:
-				template <class... Ts>
-				explicit direct_control_block(Ts&&... ts) : u_(U(std::forward<Ts>(ts)...)) {}
+			template <class... Ts>
+			explicit direct_block(const heap_ops& ops, Ts&&... ts) : heap_block(ops), u(std::forward<Ts>(ts)...) {}
+			};
 
-				std::unique_ptr<control_block<T>> clone() const override
-					{
-					return std::make_unique<direct_control_block>(*this);
-					}
+		template <class U>
+		inline constexpr heap_ops direct_ops
+			{
+			[](const heap_block* block) -> heap_block*
+				{
+				const auto& self = *static_cast<const direct_block<U>*>(block);
+				return new direct_block<U>(*self.ops, self.u);
+				},
+			[](heap_block* block) noexcept { delete static_cast<direct_block<U>*>(block); },
+			[](heap_block* block) noexcept -> void* { return std::addressof(static_cast<direct_block<U>*>(block)->u); }
+			};
+
+		template <class U, class C, class D>
+		struct pointer_block : heap_block, C
+			{
+			std::unique_ptr<U, D> p;
+
+			pointer_block(const heap_ops& ops, std::unique_ptr<U, D> p, C c) : heap_block(ops), C(std::move(c)), p(std::move(p)) {}
+			};
 
-				T* ptr() override { return std::addressof(u_); }
+		template <class U, class C, class D>
+		inline constexpr heap_ops pointer_ops
+			{
+			[](const heap_block* block) -> heap_block*
+				{
+				const auto& self = *static_cast<const pointer_block<U, C, D>*>(block);
+				assert(self.p);
+				std::unique_ptr<U, D> copy(self.C::operator()(*self.p), self.p.get_deleter());
+				return new pointer_block<U, C, D>(*self.ops, std::move(copy), static_cast<const C&>(self));
+				},
+			[](heap_block* block) noexcept { delete static_cast<pointer_block<U, C, D>*>(block); },
+			[](heap_block* block) noexcept -> void* { return static_cast<pointer_block<U, C, D>*>(block)->p.get(); }
 			};
 
-		template <class T, class U, class C = default_copy<U>,
-			class D = default_delete<U>>
-			class pointer_control_block : public control_block<T>, public C
+		// Block allocated, and cloned, through an allocator: std::pmr::polymorphic_allocator to draw from a memory_resource, or any custom arena.
+		template <class U, class A>
+		struct allocated_block : heap_block
 			{
-			std::unique_ptr<U, D> p_;
+			static_assert(!std::is_reference<U>::value, "");
 
-			public:
-				explicit pointer_control_block(U* u, C c = C{}, D d = D{})
-					: C(std::move(c)), p_(u, std::move(d))
-					{}
+			using allocator_type = typename std::allocator_traits<A>::template rebind_alloc<allocated_block>;
+			using traits = std::allocator_traits<allocator_type>;
 
-				explicit pointer_control_block(std::unique_ptr<U, D> p, C c = C{})
-					: C(std::move(c)), p_(std::move(p))
-					{}
+			U u;
+			allocator_type allocator;
 
-				std::unique_ptr<control_block<T>> clone() const override
-					{
-					assert(p_);
-					return std::make_unique<pointer_control_block>(
-						C::operator()(*p_), static_cast<const C&>(*this), p_.get_deleter());
-					}
+			template <class... Ts>
+			explicit allocated_block(const heap_ops& ops, const allocator_type& a, Ts&&... ts) : heap_block(ops), u(std::forward<Ts>(ts)...), allocator(a) {}
 
-				T* ptr() override { return p_.get(); }
+			template <class... Ts>
+			static allocated_block* make(const heap_ops& ops, allocator_type allocator, Ts&&... ts)
+				{
+				allocated_block* block = traits::allocate(allocator, 1);
+				try { ::new (static_cast<void*>(block)) allocated_block(ops, allocator, std::forward<Ts>(ts)...); }
+				catch (...) { traits::deallocate(allocator, block, 1); throw; }
+				return block;
+				}
+
+			static void destroy(allocated_block* block) noexcept
+				{
+				allocator_type allocator(block->allocator);
+				block->~allocated_block();
+				traits::deallocate(allocator, block, 1);
+				}
 			};
 
-		template <class T, class U>
-		class delegating_control_block : public control_block<T>
+		template <class U, class A>
+		inline constexpr heap_ops allocated_ops
 			{
-			std::unique_ptr<control_block<U>> delegate_;
+			[](const heap_block* block) -> heap_block*
+				{
+				const auto& self = *static_cast<const allocated_block<U, A>*>(block);
+				return allocated_block<U, A>::make(*self.ops, self.allocator, self.u);
+				},
+			[](heap_block* block) noexcept { allocated_block<U, A>::destroy(static_cast<allocated_block<U, A>*>(block)); },
+			[](heap_block* block) noexcept -> void* { return std::addressof(static_cast<allocated_block<U, A>*>(block)->u); }
+			};
 
+		// Copy, move and destroy for an object which type was erased, used for objects living in the inline storage of a polymorphic_value.
+		struct inline_ops
+			{
+			size_t size;
+			size_t alignment;
+			void (*copy)(const void* source, void* destination);
+			// Move constructs destination, then destroys source.
+			void (*relocate)(void* source, void* destination) noexcept;
+			void (*destroy)(void* object) noexcept;
+			};
+
+		template <class U>
+		inline constexpr inline_ops inline_ops_for
+			{
+			sizeof(U), alignof(U),
+			[](const void* source, void* destination) { ::new (destination) U(*static_cast<const U*>(source)); },
+			[](void* source, void* destination) noexcept
+				{
+				::new (destination) U(std::move(*static_cast<U*>(source)));
+				static_cast<U*>(source)->~U();
+				},
+			[](void* object) noexcept { static_cast<U*>(object)->~U(); }
+			};
+
+		// Takes an object out of an inline storage too small for it, when converting to a polymorphic_value with less inline space.
+		class erased_block : public heap_block
+			{
 			public:
-				explicit delegating_control_block(std::unique_ptr<control_block<U>> b)
-					: delegate_(std::move(b))
-					{}
+				const inline_ops* object_ops;
+				void* storage;
+
+				erased_block(const heap_ops& ops, const inline_ops& object_ops, const void* source) : heap_block(ops), object_ops(&object_ops), storage(allocate(object_ops))
+					{
+					try { object_ops.copy(source, storage); }
+					catch (...) { deallocate(); throw; }
+					}
 
-				std::unique_ptr<control_block<T>> clone() const override
+				erased_block(const heap_ops& ops, const inline_ops& object_ops, void* source, std::true_type /*relocate*/) : heap_block(ops), object_ops(&object_ops), storage(allocate(object_ops))
 					{
-					return std::make_unique<delegating_control_block>(delegate_->clone());
+					object_ops.relocate(source, storage);
 					}
 
-				T* ptr() override { return delegate_->ptr(); }
+				erased_block(const erased_block& copy) = delete;
+				erased_block& operator=(const erased_block& copy) = delete;
+
+				~erased_block()
+					{
+					object_ops->destroy(storage);
+					deallocate();
+					}
+
+			private:
+				static void* allocate(const inline_ops& object_ops) { return ::operator new(object_ops.size, std::align_val_t{object_ops.alignment}); }
+				void deallocate() noexcept { ::operator delete(storage, std::align_val_t{object_ops->alignment}); }
 			};
 
+		inline constexpr heap_ops erased_ops
+			{
+			[](const heap_block* block) -> heap_block*
+				{
+				const auto& self = *static_cast<const erased_block*>(block);
+				return new erased_block(*self.ops, *self.object_ops, static_cast<const void*>(self.storage));
+				},
+			[](heap_block* block) noexcept { delete static_cast<erased_block*>(block); },
+			[](heap_block* block) noexcept { return static_cast<erased_block*>(block)->storage; }
+			};
+
+		template <size_t size, size_t alignment>
+		struct inline_storage
+			{
+			const inline_ops* ops = nullptr; //null when the object isn't stored inline
+			alignas(alignment) std::byte bytes[size];
+			};
+
+		template <size_t alignment>
+		struct inline_storage<0, alignment> {};
+
 		}  // end namespace detail
 
 	class bad_polymorphic_value_construction : public std::exception
@@ -134,42 +251,42 @@ namespace utils
 				}
 		};
 
-	template <class T>
+	// inline_size and inline_alignment: objects of derived types which fit, and which can be moved without throwing, are stored inside the polymorphic_value instead of the heap.
+	template <class T, size_t inline_size = 0, size_t inline_alignment = alignof(std::max_align_t)>
 	class polymorphic_value;
 
 	template <class T>
 	struct is_polymorphic_value : std::false_type {};
 
-	template <class T>
-	struct is_polymorphic_value<polymorphic_value<T>> : std::true_type {};
+	template <class T, size_t inline_size, size_t inline_alignment>
+	struct is_polymorphic_value<polymorphic_value<T, inline_size, inline_alignment>> : std::true_type {};
 
 	////////////////////////////////////////////////////////////////////////////////
 	// `polymorphic_value` class definition
 	////////////////////////////////////////////////////////////////////////////////
 
-	template <class T>
+	template <class T, size_t inline_size, size_t inline_alignment>
 	class polymorphic_value
 		{
 		static_assert(!std::is_union<T>::value, "");
 		static_assert(std::is_class<T>::value, "");
 
-		template <class U>
+		template <class, size_t, size_t>
 		friend class polymorphic_value;
 
-		template <class T_, class U, class... Ts>
-		friend polymorphic_value<T_> make_polymorphic_value(Ts&&... ts);
-		template <class T_, class... Ts>
-		friend polymorphic_value<T_> make_polymorphic_value(Ts&&... ts);
+		template <class U>
+		static constexpr bool fits_inline = inline_size > 0 && sizeof(U) <= inline_size && alignof(U) <= inline_alignment && std::is_nothrow_move_constructible<U>::value;
 
 		T* ptr_ = nullptr;
-		std::unique_ptr<detail::control_block<T>> cb_;
+		detail::heap_block* block_ = nullptr; //heap block holding the object, null if there's no object or it's stored inline
+		utils_no_unique_address detail::inline_storage<inline_size, inline_alignment> storage_;
 
 		public:
 			//
 			// Destructor
 			//
 
-			~polymorphic_value() = default;
+			~polymorphic_value() { reset(); }
 
 			//
 			// Constructors
@@ -194,9 +311,7 @@ namespace utils
 					throw bad_polymorphic_value_construction();
 #endif
 				std::unique_ptr<U, D> p(u, std::move(deleter));
-
-				cb_ = std::make_unique<detail::pointer_control_block<T, U, C, D>>(
-					std::move(p), std::move(copier));
+				block_ = new detail::pointer_block<U, C, D>(detail::pointer_ops<U, C, D>, std::move(p), std::move(copier));
 				ptr_ = u;
 				}
 
@@ -206,13 +321,7 @@ namespace utils
 
 			polymorphic_value(const polymorphic_value& p)
 				{
-				if (!p)
-					{
-					return;
-					}
-				auto tmp_cb = p.cb_->clone();
-				ptr_ = tmp_cb->ptr();
-				cb_ = std::move(tmp_cb);
+				copy_from(p);
 				}
 
 			//
@@ -221,35 +330,27 @@ namespace utils
 
 			polymorphic_value(polymorphic_value&& p) noexcept
 				{
-				ptr_ = p.ptr_;
-				cb_ = std::move(p.cb_);
-				p.ptr_ = nullptr;
+				move_from(p);
 				}
 
 			//
 			// Converting constructors
 			//
 
-			template <class U,
-				class V = std::enable_if_t<!std::is_same<T, U>::value&&
+			template <class U, size_t U_inline_size, size_t U_inline_alignment,
+				class V = std::enable_if_t<!std::is_same<polymorphic_value<U, U_inline_size, U_inline_alignment>, polymorphic_value>::value&&
 				std::is_convertible<U*, T*>::value>>
-				explicit polymorphic_value(const polymorphic_value<U>& p)
+				explicit polymorphic_value(const polymorphic_value<U, U_inline_size, U_inline_alignment>& p)
 				{
-				polymorphic_value<U> tmp(p);
-				ptr_ = tmp.ptr_;
-				cb_ = std::make_unique<detail::delegating_control_block<T, U>>(
-					std::move(tmp.cb_));
+				copy_from(p);
 				}
 
-			template <class U,
-				class V = std::enable_if_t<!std::is_same<T, U>::value&&
+			template <class U, size_t U_inline_size, size_t U_inline_alignment,
+				class V = std::enable_if_t<!std::is_same<polymorphic_value<U, U_inline_size, U_inline_alignment>, polymorphic_value>::value&&
 				std::is_convertible<U*, T*>::value>>
-				explicit polymorphic_value(polymorphic_value<U>&& p)
+				explicit polymorphic_value(polymorphic_value<U, U_inline_size, U_inline_alignment>&& p)
 				{
-				ptr_ = p.ptr_;
-				cb_ = std::make_unique<detail::delegating_control_block<T, U>>(
-					std::move(p.cb_));
-				p.ptr_ = nullptr;
+				move_from(p);
 				}
 
 			//
@@ -262,33 +363,62 @@ namespace utils
 				!is_polymorphic_value<std::decay_t<U>>::value>,
 				class... Ts>
 				explicit polymorphic_value(std::in_place_type_t<U>, Ts&&... ts)
-				: cb_(std::make_unique<detail::direct_control_block<T, U>>(
-					std::forward<Ts>(ts)...))
 				{
-				ptr_ = cb_->ptr();
+				if constexpr (fits_inline<U>)
+					{
+					U* u = ::new (static_cast<void*>(storage_.bytes)) U(std::forward<Ts>(ts)...);
+					storage_.ops = &detail::inline_ops_for<U>;
+					ptr_ = u;
+					}
+				else
+					{
+					auto* block = new detail::direct_block<U>(detail::direct_ops<U>, std::forward<Ts>(ts)...);
+					block_ = block;
+					ptr_ = std::addressof(block->u);
+					}
 				}
 
 			//
-			// Assignment
+			// Allocator-extended in-place constructor
 			//
 
-			polymorphic_value& operator=(const polymorphic_value& p)
+			// Objects which don't fit the inline storage are allocated, and cloned on copy, through alloc.
+			template <class A, class U,
+				class V = std::enable_if_t<
+				std::is_convertible<std::decay_t<U>*, T*>::value &&
+				!is_polymorphic_value<std::decay_t<U>>::value>,
+				class... Ts>
+				polymorphic_value(std::allocator_arg_t, const A& alloc, std::in_place_type_t<U>, Ts&&... ts)
 				{
-				if (std::addressof(p) == this)
+				if constexpr (fits_inline<U>)
 					{
-					return *this;
+					U* u = ::new (static_cast<void*>(storage_.bytes)) U(std::forward<Ts>(ts)...);
+					storage_.ops = &detail::inline_ops_for<U>;
+					ptr_ = u;
 					}
+				else
+					{
+					using block_t = detail::allocated_block<U, A>;
+					block_t* block = block_t::make(detail::allocated_ops<U, A>, typename block_t::allocator_type(alloc), std::forward<Ts>(ts)...);
+					block_ = block;
+					ptr_ = std::addressof(block->u);
+					}
+				}
 
-				if (!p)
+			//
+			// Assignment
+			//
+
+			polymorphic_value& operator=(const polymorphic_value& p)
+				{
+				if (std::addressof(p) == this)
 					{
-					cb_.reset();
-					ptr_ = nullptr;
 					return *this;
 					}
 
-				auto tmp_cb = p.cb_->clone();
-				ptr_ = tmp_cb->ptr();
-				cb_ = std::move(tmp_cb);
+				polymorphic_value tmp(p);
+				reset();
+				move_from(tmp);
 				return *this;
 				}
 
@@ -303,9 +433,8 @@ namespace utils
 					return *this;
 					}
 
-				cb_ = std::move(p.cb_);
-				ptr_ = p.ptr_;
-				p.ptr_ = nullptr;
+				reset();
+				move_from(p);
 				return *this;
 				}
 
@@ -315,16 +444,41 @@ namespace utils
 
 			void swap(polymorphic_value& p) noexcept
 				{
-				using std::swap;
-				swap(ptr_, p.ptr_);
-				swap(cb_, p.cb_);
+				polymorphic_value tmp(std::move(p));
+				p = std::move(*this);
+				*this = std::move(tmp);
+				}
+
+			void reset() noexcept
+				{
+				if constexpr (inline_size > 0)
+					{
+					if (is_inline())
+						{
+						storage_.ops->destroy(storage_.bytes);
+						storage_.ops = nullptr;
+						}
+					}
+				if (block_)
+					{
+					block_->ops->destroy(block_);
+					block_ = nullptr;
+					}
+				ptr_ = nullptr;
 				}
 
 			//
 			// Observers
 			//
 
-			explicit operator bool() const { return bool(cb_); }
+			explicit operator bool() const { return ptr_ != nullptr; }
+
+			// Whether the object lives in the inline storage rather than in the heap.
+			bool is_inline() const noexcept
+				{
+				if constexpr (inline_size > 0) { return storage_.ops != nullptr; }
+				else { return false; }
+				}
 
 			const T* operator->() const
 				{
@@ -349,35 +503,229 @@ namespace utils
 				assert(*this);
 				return *ptr_;
 				}
+
+		private:
+			// Where the T subobject of an inline object is, relative to the start of the inline storage.
+			template <class U, size_t U_inline_size, size_t U_inline_alignment>
+			static std::ptrdiff_t inline_offset(const polymorphic_value<U, U_inline_size, U_inline_alignment>& p) noexcept
+				{
+				const T* t = p.ptr_;
+				return reinterpret_cast<const std::byte*>(t) - p.storage_.bytes;
+				}
+
+			// Where the T subobject of a heap object is, relative to the start of the most derived object.
+			template <class U, size_t U_inline_size, size_t U_inline_alignment>
+			static std::ptrdiff_t heap_offset(const polymorphic_value<U, U_inline_size, U_inline_alignment>& p) noexcept
+				{
+				const T* t = p.ptr_;
+				return reinterpret_cast<const std::byte*>(t) - static_cast<const std::byte*>(p.block_->ops->object(p.block_));
+				}
+
+			static T* at_offset(void* object, std::ptrdiff_t offset) noexcept
+				{
+				return std::launder(reinterpret_cast<T*>(static_cast<std::byte*>(object) + offset));
+				}
+
+			template <class U, size_t U_inline_size, size_t U_inline_alignment>
+			void copy_from(const polymorphic_value<U, U_inline_size, U_inline_alignment>& p)
+				{
+				if (!p)
+					{
+					return;
+					}
+
+				if (p.is_inline())
+					{
+					if constexpr (U_inline_size > 0)
+						{
+						const detail::inline_ops& ops = *p.storage_.ops;
+						if constexpr (inline_size > 0)
+							{
+							if (ops.size <= inline_size && ops.alignment <= inline_alignment)
+								{
+								ops.copy(p.storage_.bytes, storage_.bytes);
+								storage_.ops = &ops;
+								ptr_ = std::launder(reinterpret_cast<T*>(storage_.bytes + inline_offset(p)));
+								return;
+								}
+							}
+						auto* block = new detail::erased_block(detail::erased_ops, ops, static_cast<const void*>(p.storage_.bytes));
+						block_ = block;
+						ptr_ = at_offset(block->storage, inline_offset(p));
+						}
+					return;
+					}
+
+				//Same block type as the source, so the T subobject is at the same offset
+				block_ = p.block_->ops->clone(p.block_);
+				ptr_ = at_offset(block_->ops->object(block_), heap_offset(p));
+				}
+
+			template <class U, size_t U_inline_size, size_t U_inline_alignment>
+			void move_from(polymorphic_value<U, U_inline_size, U_inline_alignment>& p)
+				{
+				if (!p)
+					{
+					return;
+					}
+
+				if (p.is_inline())
+					{
+					if constexpr (U_inline_size > 0)
+						{
+						const detail::inline_ops& ops = *p.storage_.ops;
+						const std::ptrdiff_t offset = inline_offset(p);
+						bool relocated_inline = false;
+						if constexpr (inline_size > 0)
+							{
+							if (ops.size <= inline_size && ops.alignment <= inline_alignment)
+								{
+								ops.relocate(p.storage_.bytes, storage_.bytes);
+								storage_.ops = &ops;
+								ptr_ = std::launder(reinterpret_cast<T*>(storage_.bytes + offset));
+								relocated_inline = true;
+								}
+							}
+						if (!relocated_inline)
+							{
+							auto* block = new detail::erased_block(detail::erased_ops, ops, static_cast<void*>(p.storage_.bytes), std::true_type{});
+							block_ = block;
+							ptr_ = at_offset(block->storage, offset);
+							}
+						p.storage_.ops = nullptr;
+						p.ptr_ = nullptr;
+						}
+					return;
+					}
+
+				//Blocks don't depend on the static type, converting only adjusts the cached pointer
+				ptr_ = p.ptr_;
+				block_ = p.block_;
+				p.ptr_ = nullptr;
+				p.block_ = nullptr;
+				}
 		};
 
+	namespace detail
+		{
+		struct size_probe {};
+		}
+	static_assert(sizeof(polymorphic_value<detail::size_probe>) == 2 * sizeof(void*), "a polymorphic_value without inline storage must stay two pointers");
+
 	//
 	// polymorphic_value creation
 	//
 	template <class T, class... Ts>
 	polymorphic_value<T> make_polymorphic_value(Ts&&... ts)
 		{
-		polymorphic_value<T> p;
-		p.cb_ = std::make_unique<detail::direct_control_block<T, T>>(
-			std::forward<Ts>(ts)...);
-		p.ptr_ = p.cb_->ptr();
-		return p;
+		return polymorphic_value<T>(std::in_place_type<T>, std::forward<Ts>(ts)...);
 		}
 	template <class T, class U, class... Ts>
 	polymorphic_value<T> make_polymorphic_value(Ts&&... ts)
 		{
-		polymorphic_value<T> p;
-		p.cb_ = std::make_unique<detail::direct_control_block<T, U>>(
-			std::forward<Ts>(ts)...);
-		p.ptr_ = p.cb_->ptr();
-		return p;
+		return polymorphic_value<T>(std::in_place_type<U>, std::forward<Ts>(ts)...);
+		}
+
+	template <class T, class A, class... Ts>
+	polymorphic_value<T> allocate_polymorphic_value(const A& alloc, Ts&&... ts)
+		{
+		return polymorphic_value<T>(std::allocator_arg, alloc, std::in_place_type<T>, std::forward<Ts>(ts)...);
+		}
+	template <class T, class U, class A, class... Ts>
+	polymorphic_value<T> allocate_polymorphic_value(const A& alloc, Ts&&... ts)
+		{
+		return polymorphic_value<T>(std::allocator_arg, alloc, std::in_place_type<U>, std::forward<Ts>(ts)...);
 		}
 
 	//
 	// non-member swap
 	//
-	template <class T>
-	void swap(polymorphic_value<T>& t, polymorphic_value<T>& u) noexcept
+	template <class T, size_t inline_size, size_t inline_alignment>
+	void swap(polymorphic_value<T, inline_size, inline_alignment>& t, polymorphic_value<T, inline_size, inline_alignment>& u) noexcept
+		{
+		t.swap(u);
+		}
+
+	////////////////////////////////////////////////////////////////////////////////
+	// `cow_polymorphic_value` class definition
+	////////////////////////////////////////////////////////////////////////////////
+
+	// Copy-on-write polymorphic_value: copies share the same object, which is cloned on the first mutable access of a copy while it's still shared.
+	// Const access never clones; use std::as_const to read through a non-const cow_polymorphic_value without unsharing it.
+	// Copies may be read concurrently, but a copy must not be mutated while another thread is copying or reading the same cow_polymorphic_value.
+	template <class T, size_t inline_size = 0, size_t inline_alignment = alignof(std::max_align_t)>
+	class cow_polymorphic_value
+		{
+		public:
+			using value_type = polymorphic_value<T, inline_size, inline_alignment>;
+
+			cow_polymorphic_value() = default;
+
+			explicit cow_polymorphic_value(value_type value)
+				: shared_(value ? std::make_shared<value_type>(std::move(value)) : nullptr)
+				{}
+
+			template <class U,
+				class V = std::enable_if_t<std::is_convertible<std::decay_t<U>*, T*>::value>,
+				class... Ts>
+				explicit cow_polymorphic_value(std::in_place_type_t<U> in_place, Ts&&... ts)
+				: shared_(std::make_shared<value_type>(in_place, std::forward<Ts>(ts)...))
+				{}
+
+			explicit operator bool() const noexcept { return static_cast<bool>(shared_); }
+
+			// Whether other copies currently share the object.
+			bool is_shared() const noexcept { return shared_.use_count() > 1; }
+
+			const T* operator->() const
+				{
+				assert(shared_);
+				return std::addressof(**shared_);
+				}
+
+			const T& operator*() const
+				{
+				assert(shared_);
+				return **shared_;
+				}
+
+			T* operator->()
+				{
+				assert(shared_);
+				return std::addressof(*unshare());
+				}
+
+			T& operator*()
+				{
+				assert(shared_);
+				return *unshare();
+				}
+
+			void swap(cow_polymorphic_value& p) noexcept { shared_.swap(p.shared_); }
+
+		private:
+			std::shared_ptr<value_type> shared_;
+
+			value_type& unshare()
+				{
+				if (shared_.use_count() > 1) { shared_ = std::make_shared<value_type>(*shared_); }
+				return *shared_;
+				}
+		};
+
+	template <class T, class... Ts>
+	cow_polymorphic_value<T> make_cow_polymorphic_value(Ts&&... ts)
+		{
+		return cow_polymorphic_value<T>(std::in_place_type<T>, std::forward<Ts>(ts)...);
+		}
+	template <class T, class U, class... Ts>
+	cow_polymorphic_value<T> make_cow_polymorphic_value(Ts&&... ts)
+		{
+		return cow_polymorphic_value<T>(std::in_place_type<U>, std::forward<Ts>(ts)...);
+		}
+
+	template <class T, size_t inline_size, size_t inline_alignment>
+	void swap(cow_polymorphic_value<T, inline_size, inline_alignment>& t, cow_polymorphic_value<T, inline_size, inline_alignment>& u) noexcept
 		{
 		t.swap(u);
 		}
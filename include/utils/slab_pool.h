@@ -0,0 +1,135 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+namespace utils
+	{
+	// Hands out storage for single objects of type T, carved from slabs of slab_capacity objects.
+	// Allocation pops a free list and deallocation pushes it, the allocator is only reached to add a slab.
+	// Not thread safe: use one pool per thread, see thread_allocate. Storage may be returned to a different thread's pool than the one it came from.
+	// Slabs are never handed back to the allocator before the program ends, so storage stays valid after the pool that created it is destroyed.
+	template <typename T, size_t slab_capacity = 256>
+	class slab_pool
+		{
+		union node
+			{
+			node* next;
+			alignas(T) std::byte storage[sizeof(T)];
+			};
+		using slab_t = std::unique_ptr<node[]>;
+
+		// Pushes the nodes of a new slab on free_list.
+		static slab_t make_slab(node*& free_list)
+			{
+			slab_t slab{std::make_unique_for_overwrite<node[]>(slab_capacity)};
+			for (size_t i = 0; i < slab_capacity; i++) { slab[i].next = free_list; free_list = &slab[i]; }
+			return slab;
+			}
+
+		// Collects slabs and free storage of destroyed pools, so that other threads can reuse them.
+		// Also serves threads whose pool was already destroyed, i.e. while thread_local and static objects are destroyed.
+		class depot
+			{
+			public:
+				void adopt(std::vector<slab_t>&& slabs, node* free_list)
+					{
+					std::scoped_lock lock{mutex};
+					for (auto& slab : slabs) { this->slabs.push_back(std::move(slab)); }
+					while (free_list) { node* next{free_list->next}; free_list->next = this->free_list; this->free_list = free_list; free_list = next; }
+					}
+				node* take_free_list() noexcept
+					{
+					std::scoped_lock lock{mutex};
+					node* ret{free_list};
+					free_list = nullptr;
+					return ret;
+					}
+
+				void* allocate()
+					{
+					std::scoped_lock lock{mutex};
+					if (!free_list) { slabs.push_back(make_slab(free_list)); }
+					node* ret{free_list};
+					free_list = free_list->next;
+					return ret->storage;
+					}
+				void deallocate(void* storage) noexcept
+					{
+					std::scoped_lock lock{mutex};
+					node* freed{reinterpret_cast<node*>(storage)};
+					freed->next = free_list;
+					free_list = freed;
+					}
+
+			private:
+				std::mutex mutex;
+				std::vector<slab_t> slabs;
+				node* free_list{nullptr};
+			};
+		// Never destroyed, pools and storage can outlive every other static object.
+		static depot& get_depot() { static depot& instance{*new depot}; return instance; }
+
+		// Trivially destructible, so it can still be read after the thread's pool is destroyed.
+		enum class thread_state : unsigned char { unused, alive, destroyed };
+		static thread_state& get_thread_state() noexcept { thread_local thread_state state{thread_state::unused}; return state; }
+
+		public:
+			slab_pool() = default;
+			slab_pool(const slab_pool& copy) = delete;
+			slab_pool& operator=(const slab_pool& copy) = delete;
+			~slab_pool() { get_depot().adopt(std::move(slabs), free_list); }
+
+			// The calling thread's pool. Must not be used once the thread's thread_local objects are being destroyed, prefer thread_allocate and thread_deallocate.
+			static slab_pool& thread_instance() { thread_local thread_instance_t instance; return instance; }
+
+			// Through the calling thread's pool, or the depot once the thread's pool is destroyed.
+			static void* thread_allocate()
+				{
+				if (get_thread_state() == thread_state::destroyed) { return get_depot().allocate(); }
+				return thread_instance().allocate();
+				}
+			static void thread_deallocate(void* storage) noexcept
+				{
+				if (get_thread_state() == thread_state::destroyed) { get_depot().deallocate(storage); }
+				else { thread_instance().deallocate(storage); }
+				}
+
+			// Uninitialized storage for a T.
+			void* allocate()
+				{
+				if (!free_list) { refill(); }
+				node* ret{free_list};
+				free_list = free_list->next;
+				return ret->storage;
+				}
+
+			// Storage previously returned by allocate, of this or any other pool of the same type. The object must already be destroyed.
+			void deallocate(void* storage) noexcept
+				{
+				node* freed{reinterpret_cast<node*>(storage)};
+				freed->next = free_list;
+				free_list = freed;
+				}
+
+		private:
+			std::vector<slab_t> slabs;
+			node* free_list{nullptr};
+
+			// Marks the thread's pool as destroyed once its destructor has handed everything to the depot.
+			struct thread_instance_t : slab_pool
+				{
+				thread_instance_t() noexcept { get_thread_state() = thread_state::alive; }
+				~thread_instance_t() { get_thread_state() = thread_state::destroyed; }
+				};
+
+			void refill()
+				{
+				free_list = get_depot().take_free_list();
+				if (free_list) { return; }
+				slabs.push_back(make_slab(free_list));
+				}
+		};
+	}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <ranges>
+#include <iterator>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+namespace utils
+	{
+	// Fixed set of worker threads for fork-join work: parallel_for hands out indices to the workers and returns when all of them are done.
+	// A thread waiting in parallel_for runs queued work meanwhile, so parallel_for can be nested inside tasks.
+	class thread_pool
+		{
+		public:
+			// The thread calling parallel_for works too, hence one less worker than the hardware threads by default.
+			explicit thread_pool(size_t workers_count = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+				{
+				workers.reserve(workers_count);
+				for (size_t i = 0; i < workers_count; i++) { workers.emplace_back(&thread_pool::work, this); }
+				}
+
+			thread_pool(const thread_pool& copy) = delete;
+			thread_pool& operator=(const thread_pool& copy) = delete;
+
+			~thread_pool()
+				{
+					{
+					std::lock_guard lock{mutex};
+					running = false;
+					}
+				state_changed.notify_all();
+				for (auto& worker : workers) { worker.join(); }
+				}
+
+			size_t workers_count() const noexcept { return workers.size(); }
+
+			// Calls task(i) for every i in [0, count), concurrently. If a call throws, the indices not started yet are skipped and the first exception is rethrown.
+			template <typename Task>
+			void parallel_for(size_t count, Task task)
+				{
+				if (count == 0) { return; }
+
+				job_state job;
+				const auto run{[&]
+					{
+					for (size_t i = job.next++; i < count; i = job.next++)
+						{
+						try { task(i); }
+						catch (...) { fail(job, count); }
+						}
+					}};
+
+				const size_t helpers{std::min(count - 1, workers.size())};
+				if (helpers)
+					{
+						{
+						std::lock_guard lock{mutex};
+						for (size_t i = 0; i < helpers; i++) { queue.emplace_back([&] { run(); helper_done(job); }); }
+						job.helpers_pending = helpers;
+						}
+					state_changed.notify_all();
+					}
+
+				run();
+
+				std::unique_lock lock{mutex};
+				while (job.helpers_pending) { run_queued_or_wait(lock); }
+				if (job.exception) { std::rethrow_exception(job.exception); }
+				}
+
+		private:
+			struct job_state
+				{
+				std::atomic<size_t> next{0};
+				size_t helpers_pending{0};
+				std::exception_ptr exception;
+				};
+
+			std::vector<std::thread> workers;
+			std::deque<std::function<void()>> queue;
+			std::mutex mutex;
+			std::condition_variable state_changed; //new work, finished helpers or shutdown
+			bool running{true};
+
+			void work()
+				{
+				std::unique_lock lock{mutex};
+				while (running || !queue.empty()) { run_queued_or_wait(lock); }
+				}
+
+			void run_queued_or_wait(std::unique_lock<std::mutex>& lock)
+				{
+				if (queue.empty()) { state_changed.wait(lock); return; }
+
+				auto task{std::move(queue.front())};
+				queue.pop_front();
+				lock.unlock();
+				task();
+				lock.lock();
+				}
+
+			void helper_done(job_state& job)
+				{
+					{
+					std::lock_guard lock{mutex};
+					job.helpers_pending--;
+					}
+				state_changed.notify_all();
+				}
+
+			void fail(job_state& job, size_t count)
+				{
+				std::lock_guard lock{mutex};
+				if (!job.exception) { job.exception = std::current_exception(); }
+				job.next = count;
+				}
+		};
+
+	inline constexpr size_t default_parallel_chunk_size{4096};
+
+	// Calls function on each element of range, concurrently. Random access ranges are split in chunks of chunk_size elements, other ranges are iterated by a single thread.
+	template <std::ranges::range Range, typename Function>
+	void parallel_for_each(thread_pool& pool, Range&& range, Function function, size_t chunk_size = default_parallel_chunk_size)
+		{
+		if constexpr (std::ranges::random_access_range<Range> && std::ranges::sized_range<Range>)
+			{
+			const size_t size{static_cast<size_t>(std::ranges::size(range))};
+			const auto begin{std::ranges::begin(range)};
+			pool.parallel_for((size + chunk_size - 1) / chunk_size, [&](size_t chunk)
+				{
+				const size_t first{chunk * chunk_size};
+				const size_t last{std::min(first + chunk_size, size)};
+				for (auto it{begin + first}; it != begin + last; ++it) { function(*it); }
+				});
+			}
+		else { for (auto&& element : range) { function(element); } }
+		}
+	}
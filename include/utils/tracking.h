@@ -2,32 +2,77 @@
 #include <memory>
 #include <stdexcept>
 #include <concepts>
+#include <atomic>
+#include <thread>
 
 #include "wrapper.h"
+#include "slab_pool.h"
 #include "compilation/debug.h"
 
 namespace utils
 	{
-	class trackable;
+	namespace tracker_storage
+		{
+		// Every tracker is allocated on its own through std::make_shared.
+		struct heap {};
+		// Trackers are drawn from a per-thread slab_pool and reference counted intrusively: creating one is a free-list pop, releasing the last reference a push.
+		struct pooled {};
+		}
+
+	// Selects how the tracking subsystem works. Derive from it and override members to customize.
+	struct tracking_policy
+		{
+		using storage = tracker_storage::heap;
+		// Whether trackables and tracking_ptr to them may be used from different threads. When false reference counts are plain integers.
+		inline static constexpr bool thread_safe{true};
+		// When true trackables get a tracker only once the first tracking_ptr to them is taken, and a moved-from trackable is left without one.
+		// Constructing and relocating trackables nobody tracks then never allocates, at the cost of a branch when taking a tracking_ptr.
+		inline static constexpr bool lazy{false};
+		// When true tracking_ptr may follow a trackable_wrapper from other threads while its owner moves or destroys it: readers pin() the object for the duration of an access,
+		// relocation waits for pinned readers and publishes the new address atomically. Requires thread_safe, not compatible with lazy nor with inheritance based trackables.
+		inline static constexpr bool concurrent{false};
+		};
+
+	struct pooled_tracking_policy : tracking_policy { using storage = tracker_storage::pooled; };
+	// For trackables that never leave the thread which created them and their tracking_ptr.
+	struct single_threaded_tracking_policy : pooled_tracking_policy { inline static constexpr bool thread_safe{false}; };
+	struct lazy_tracking_policy : pooled_tracking_policy { inline static constexpr bool lazy{true}; };
+	struct concurrent_tracking_policy : tracking_policy { inline static constexpr bool concurrent{true}; };
+
+	template <typename Policy = tracking_policy>
+	class basic_trackable;
+	template <typename T, typename Policy = tracking_policy>
+	class trackable_wrapper;
+
+	namespace _
+		{
+		template <typename Policy>
+		Policy policy_of_base(const basic_trackable<Policy>*);
+		tracking_policy policy_of_base(const void*);
+		}
+
+	// The policy of the trackable base of T, if any.
 	template <typename T>
+	using tracking_policy_of = decltype(_::policy_of_base(std::declval<T*>()));
+
+	template <typename T, typename Policy = tracking_policy_of<T>>
 	class tracking_ptr;
-	template <typename T>
-	class trackable_wrapper;
+
+	namespace container
+		{
+		template <typename T, typename Policy>
+		class tracked_vector;
+		}
 
 	namespace _
 		{
-		template <typename T>
+		template <typename T, typename Policy>
 		class tracker_updater;
 
 		// A pointer to an tracked object. This object lives in the heap and is used to share information with all identifiers about the object moving in memory.
 		template <typename T>
 		class tracker_t
 			{
-			template <typename>
-			friend class tracking_ptr;
-			template <typename>
-			friend class tracker_updater;
-
 			public:
 				tracker_t() = default;
 				tracker_t(T* tracked) noexcept : tracked{tracked} {}
@@ -41,26 +86,184 @@ namespace utils
 				T* tracked{nullptr};
 			};
 
+		// Tracker for concurrent policies. The state word holds the count of readers currently pinning the object and a bit set while its owner is writing to it.
+		// A single thread at a time writes to a given object, as with any other non atomic object; the lock only excludes readers.
 		template <typename T>
+		class concurrent_tracker_t
+			{
+			public:
+				concurrent_tracker_t() = default;
+				concurrent_tracker_t(T* tracked) noexcept : tracked{tracked} {}
+
+				concurrent_tracker_t(const concurrent_tracker_t& copy) = delete;
+				concurrent_tracker_t& operator=(const concurrent_tracker_t& copy) = delete;
+
+				concurrent_tracker_t(concurrent_tracker_t&& move) = delete;
+				concurrent_tracker_t& operator=(concurrent_tracker_t&& move) = delete;
+
+				std::atomic<T*> tracked{nullptr};
+
+				// Waits for a write in progress to finish, then keeps writers out until unpin.
+				T* pin() noexcept
+					{
+					uint32_t expected{state.load(std::memory_order_relaxed)};
+					while (true)
+						{
+						if (expected & writing) { std::this_thread::yield(); expected = state.load(std::memory_order_relaxed); }
+						else if (state.compare_exchange_weak(expected, expected + 1, std::memory_order_acquire, std::memory_order_relaxed)) { break; }
+						}
+					return tracked.load(std::memory_order_acquire);
+					}
+				void unpin() noexcept { state.fetch_sub(1, std::memory_order_release); }
+
+				// Keeps new readers out, then waits for the pinning ones to leave.
+				void lock() noexcept
+					{
+					state.fetch_or(writing, std::memory_order_acquire);
+					while (state.load(std::memory_order_acquire) != writing) { std::this_thread::yield(); }
+					}
+				void unlock() noexcept { state.fetch_and(~writing, std::memory_order_release); }
+
+			private:
+				inline static constexpr uint32_t writing{uint32_t{1} << 31};
+				std::atomic<uint32_t> state{0};
+			};
+
+		template <typename T, typename Policy>
+		using tracker_base = std::conditional_t<Policy::concurrent, concurrent_tracker_t<T>, tracker_t<T>>;
+
+		// Tracker with an intrusive reference count, atomic only if the policy is thread safe. Lives in a slab_pool or in the heap depending on the policy's storage.
+		template <typename T, typename Policy>
+		class intrusive_tracker : public tracker_base<T, Policy>
+			{
+			template <typename, typename>
+			friend class intrusive_tracker_ptr;
+
+			inline static constexpr bool pooled{std::is_same_v<typename Policy::storage, tracker_storage::pooled>};
+			using pool_t = slab_pool<intrusive_tracker>;
+
+			public:
+				intrusive_tracker(T* tracked) noexcept : tracker_base<T, Policy>{tracked} {}
+
+			private:
+				std::conditional_t<Policy::thread_safe, std::atomic<size_t>, size_t> references{1};
+
+				static intrusive_tracker* make(T* tracked)
+					{
+					if constexpr (pooled) { return new (pool_t::thread_allocate()) intrusive_tracker{tracked}; }
+					else { return new intrusive_tracker{tracked}; }
+					}
+				void acquire() noexcept
+					{
+					if constexpr (Policy::thread_safe) { references.fetch_add(1, std::memory_order_relaxed); }
+					else { references++; }
+					}
+				void release() noexcept
+					{
+					bool last;
+					if constexpr (Policy::thread_safe) { last = references.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+					else { last = --references == 0; }
+					if (!last) { return; }
+
+					if constexpr (pooled)
+						{
+						this->~intrusive_tracker();
+						pool_t::thread_deallocate(this);
+						}
+					else { delete this; }
+					}
+			};
+
+		// Owning pointer to an intrusive_tracker, with the subset of the std::shared_ptr interface trackers need.
+		template <typename T, typename Policy>
+		class intrusive_tracker_ptr
+			{
+			public:
+				intrusive_tracker_ptr() noexcept = default;
+				intrusive_tracker_ptr(std::nullptr_t) noexcept {}
+
+				intrusive_tracker_ptr(const intrusive_tracker_ptr& copy) noexcept : tracker{copy.tracker} { if (tracker) { tracker->acquire(); } }
+				intrusive_tracker_ptr& operator=(const intrusive_tracker_ptr& copy) noexcept
+					{
+					if (copy.tracker) { copy.tracker->acquire(); }
+					reset();
+					tracker = copy.tracker;
+					return *this;
+					}
+				intrusive_tracker_ptr(intrusive_tracker_ptr&& move) noexcept : tracker{move.tracker} { move.tracker = nullptr; }
+				intrusive_tracker_ptr& operator=(intrusive_tracker_ptr&& move) noexcept
+					{
+					if (this != &move) { reset(); tracker = move.tracker; move.tracker = nullptr; }
+					return *this;
+					}
+				~intrusive_tracker_ptr() noexcept { reset(); }
+
+				static intrusive_tracker_ptr make(T* tracked) { intrusive_tracker_ptr ret; ret.tracker = intrusive_tracker<T, Policy>::make(tracked); return ret; }
+
+				tracker_base<T, Policy>* get()        const noexcept { return tracker; }
+				tracker_base<T, Policy>* operator->() const noexcept { return tracker; }
+				explicit operator bool()   const noexcept { return tracker; }
+
+				void reset() noexcept { if (tracker) { tracker->release(); tracker = nullptr; } }
+
+			private:
+				intrusive_tracker<T, Policy>* tracker{nullptr};
+			};
+
+		// std::shared_ptr only for thread safe heap trackers, where its atomic count is wanted anyway.
+		template <typename T, typename Policy>
+		struct tracker_ptr_traits
+			{
+			using type = intrusive_tracker_ptr<T, Policy>;
+			static type make(T* tracked) { return type::make(tracked); }
+			};
+
+		template <typename T, typename Policy>
+			requires (std::is_same_v<typename Policy::storage, tracker_storage::heap> && Policy::thread_safe)
+		struct tracker_ptr_traits<T, Policy>
+			{
+			using type = std::shared_ptr<tracker_base<T, Policy>>;
+			static type make(T* tracked) { return std::make_shared<tracker_base<T, Policy>>(tracked); }
+			};
+
+		template <typename T, typename Policy>
+		using tracker_ptr = typename tracker_ptr_traits<T, Policy>::type;
+
+		template <typename T, typename Policy>
+		tracker_ptr<T, Policy> make_tracker(T* tracked) { return tracker_ptr_traits<T, Policy>::make(tracked); }
+
+		template <typename T, typename Policy>
 		class tracker_updater
 			{
-			template <typename>
-			friend class tracking_ptr;
+			template <typename, typename>
+			friend class utils::tracking_ptr;
+
+			static_assert(!Policy::concurrent || (Policy::thread_safe && !Policy::lazy), "Concurrent tracking policies must be thread safe and not lazy.");
 
 			public:
-				tracker_updater(T* ptr) noexcept : tracker{std::make_shared<tracker_t<T>>(ptr)} {}
+				tracker_updater(T* ptr) noexcept { if constexpr (!Policy::lazy) { tracker = make_tracker<T, Policy>(ptr); } }
 
 				tracker_updater(const tracker_updater& copy) = delete;
 				tracker_updater& operator=(const tracker_updater& copy) = delete;
 				tracker_updater(tracker_updater&& move) noexcept = delete;			  //specialized move needs tracked object's address
 				tracker_updater& operator=(tracker_updater&& move) noexcept = delete; //specialized move needs tracked object's address
 
-				tracker_updater(tracker_updater&& move, T* my_address) noexcept 
+				tracker_updater(tracker_updater&& move, T* my_address) noexcept
 					//I take the move source's tracker; tracking_ptr that were tracking my source will now track me.
 					: tracker{std::move(move.tracker)}
 					{
+					if constexpr (Policy::lazy)
+						{
+						//Source is left without a tracker, it will get one if someone starts tracking it.
+						if (tracker) { tracker->tracked = my_address; }
+						return;
+						}
+
+					//Readers stay out until the owner calls end_write, once the object itself has been moved.
+					if constexpr (Policy::concurrent) { tracker->lock(); }
+
 					//Source needs a new tracker pointing at its address, which is still stored in the tracker I stole
-					move.tracker = std::make_shared<tracker_t<T>>(tracker->tracked);
+					move.tracker = make_tracker<T, Policy>(tracker->tracked);
 
 					//Update my tracker with my address. tracking_ptr following the target of the source now point at me, where the source has moved.
 					tracker->tracked = my_address;
@@ -68,13 +271,20 @@ namespace utils
 				tracker_updater& move(tracker_updater&& move, T* my_address) noexcept
 					{
 					//I don't exist anymore; my tracker is nullified; tracking_ptr that were tracking me will now point to nullptr, because something else has been moved in my place
-					tracker->tracked = nullptr;
+					if (tracker) { tracker->tracked = nullptr; }
+					if constexpr (Policy::concurrent) { tracker->unlock(); }
 
 					//I take the move source's tracker; tracking_ptr that were tracking my source will now track me.
 					tracker = std::move(move.tracker);
 
+					if constexpr (Policy::lazy)
+						{
+						if (tracker) { tracker->tracked = my_address; }
+						return *this;
+						}
+
 					//Source needs a new tracker pointing at its address, which is still stored in the tracker I stole
-					move.tracker = std::make_shared<tracker_t<T>>(tracker->tracked);
+					move.tracker = make_tracker<T, Policy>(tracker->tracked);
 
 					//Update my tracker with my address. tracking_ptr following the target of the source now point at me, where the source has moved.
 					tracker->tracked = my_address;
@@ -85,63 +295,112 @@ namespace utils
 
 			protected:
 				void update_identified(T* ptr) noexcept { tracker->tracked = ptr; }
-				std::shared_ptr<tracker_t<T>> tracker;
+				tracker_ptr<T, Policy> tracker;
+
+				// Concurrent policies: brackets writes to the tracked object, so that no reader has it pinned meanwhile.
+				void begin_write() noexcept { if constexpr (Policy::concurrent) { tracker->lock(); } }
+				void end_write()   noexcept { if constexpr (Policy::concurrent) { tracker->unlock(); } }
+
+				// Concurrent policies: trackers must be nullified before the tracked object is destroyed, not after.
+				void detach() noexcept
+					{
+					if constexpr (Policy::concurrent)
+						{
+						tracker->lock();
+						tracker->tracked = nullptr;
+						tracker->unlock();
+						tracker = nullptr;
+						}
+					}
+
+				// The tracker to share with a new tracking_ptr; lazy policies create it here.
+				const tracker_ptr<T, Policy>& tracker_for(T* my_address)
+					{
+					if constexpr (Policy::lazy) { if (!tracker) { tracker = make_tracker<T, Policy>(my_address); } }
+					return tracker;
+					}
 			};
 		}
 
 	// The inheritance way
 	// The tracked object's address is always this.
-	class trackable : public _::tracker_updater<trackable>
+	template <typename Policy>
+	class basic_trackable : public _::tracker_updater<basic_trackable<Policy>, Policy>
 		{
-		using tup = _::tracker_updater<trackable>;
+		using tup = _::tracker_updater<basic_trackable<Policy>, Policy>;
+		static_assert(!Policy::concurrent, "Concurrent tracking needs to know when the whole object has been moved, use trackable_wrapper.");
 		public:
-			trackable() noexcept : tup{this} {} //Create a new tracker for myself
+			basic_trackable() noexcept : tup{this} {} //Create a new tracker for myself
 
-			trackable(const trackable& copy) noexcept : tup{this} {} //Create a new tracker for myself
-			trackable& operator=(const trackable& copy) noexcept { return *this; } //No need to create a new tracker; it already exists and points to my current self.
+			basic_trackable(const basic_trackable& copy) noexcept : tup{this} {} //Create a new tracker for myself
+			basic_trackable& operator=(const basic_trackable& copy) noexcept { return *this; } //No need to create a new tracker; it already exists and points to my current self.
 
-			trackable(trackable&& move) noexcept : tup{std::move(move), this} {}
-			trackable& operator=(trackable&& move) noexcept { tup::move(std::move(move), this); return *this; }
+			basic_trackable(basic_trackable&& move) noexcept : tup{std::move(move), this} {}
+			basic_trackable& operator=(basic_trackable&& move) noexcept { tup::move(std::move(move), this); return *this; }
 		};
 
+	using trackable = basic_trackable<>;
+
 	// The wrapper way
-	template <typename T>
-	class trackable_wrapper : public _::tracker_updater<T>, public wrapper<T>
+	template <typename T, typename Policy>
+	class trackable_wrapper : public _::tracker_updater<T, Policy>, public wrapper<T>
 		{
-		using tup = _::tracker_updater<T>;
+		using tup = _::tracker_updater<T, Policy>;
 		public:
 			template <typename ...Args>
-			trackable_wrapper(Args&&... args) : wrapper<T>{std::forward<Args>(args)...}, tup{std::addressof(wrapper<T>::element)} {}
+			trackable_wrapper(Args&&... args) : tup{std::addressof(wrapper<T>::element)}, wrapper<T>{std::forward<Args>(args)...} {}
 
 			//Note: copy constructors may throw for wrapper.
 			trackable_wrapper(trackable_wrapper& copy) : trackable_wrapper{static_cast<const trackable_wrapper&>(copy)} {}
 
-			trackable_wrapper(const trackable_wrapper& copy) : wrapper<T>{copy}, tup{std::addressof(wrapper<T>::element)} {}
-			trackable_wrapper& operator=(const trackable_wrapper& copy) { wrapper<T>::operator=(copy); return *this; }
+			trackable_wrapper(const trackable_wrapper& copy) : tup{std::addressof(wrapper<T>::element)}, wrapper<T>{copy} {}
+			trackable_wrapper& operator=(const trackable_wrapper& copy)
+				{
+				if constexpr (Policy::concurrent)
+					{
+					tup::begin_write();
+					try { wrapper<T>::operator=(copy); }
+					catch (...) { tup::end_write(); throw; }
+					tup::end_write();
+					}
+				else { wrapper<T>::operator=(copy); }
+				return *this;
+				}
 
 			trackable_wrapper(trackable_wrapper&& move) noexcept
-				: wrapper<T>{std::move(move.element)}, tup{std::move(move), std::addressof(wrapper<T>::element)} {}
+				: tup{std::move(move), std::addressof(wrapper<T>::element)}, wrapper<T>{std::move(move.element)} { tup::end_write(); }
 			trackable_wrapper& operator=(trackable_wrapper&& move) noexcept
 				{
+				tup::begin_write();
+				move.begin_write();
 				wrapper<T>::operator=(std::move(move));
 				tup::move(std::move(move), std::addressof(wrapper<T>::element));
+				tup::end_write();
 				return *this;
 				}
+
+			~trackable_wrapper() noexcept { tup::detach(); }
 		};
 
-	template <typename T>
+	template <typename T, typename Policy>
 	class tracking_ptr
 		{
+		using tracker_type = std::conditional_t<std::is_base_of_v<basic_trackable<Policy>, T>, basic_trackable<Policy>, T>;
+		using updater_type = _::tracker_updater<tracker_type, Policy>;
+
+		template <typename, typename>
+		friend class container::tracked_vector;
+
 		public:
 			tracking_ptr() = default;
 
 			//trackable via inheritance
-			tracking_ptr(T& tracked) : tracker{tracked.tracker} {}
-			tracking_ptr& operator=(T& tracked) { tracker = tracked.tracker; return *this; }
+			tracking_ptr(T& tracked) : tracker{tracker_of(tracked)} {}
+			tracking_ptr& operator=(T& tracked) { tracker = tracker_of(tracked); return *this; }
 
 			//trackable via wrapper
-			tracking_ptr(trackable_wrapper<T>& tracked) : tracker{tracked.tracker} {}
-			tracking_ptr& operator=(trackable_wrapper<T>& tracked) { tracker = tracked.tracker; return *this; }
+			tracking_ptr(trackable_wrapper<T, Policy>& tracked) : tracker{tracker_of(tracked)} {}
+			tracking_ptr& operator=(trackable_wrapper<T, Policy>& tracked) { tracker = tracker_of(tracked); return *this; }
 
 			tracking_ptr(const tracking_ptr& copy) = default;
 			tracking_ptr& operator=(const tracking_ptr& copy) = default;
@@ -159,13 +418,41 @@ namespace utils
 			      T* get()       { check_initialized(); return static_cast<T*>(tracker->tracked); }
 
 			operator bool()         const noexcept { return is_initialized() && has_value(); }
-			bool is_initialized()   const noexcept { return tracker.get(); }
+			bool is_initialized()   const noexcept { return static_cast<bool>(tracker); }
 			bool has_value()        const noexcept { if constexpr (compilation::debug) { return has_value_except(); } return tracker->tracked; }
 			bool has_value_except() const          { check_initialized(); return tracker->tracked; }
 
+			// Concurrent policies: keeps the tracked object from being moved or destroyed for as long as it exists; must not outlive the tracking_ptr.
+			// The owner of the object blocks while it's pinned, keep pins short.
+			class pinned
+				{
+				public:
+					pinned(_::tracker_base<tracker_type, Policy>* tracker) noexcept : tracker{tracker}, tracked{tracker ? tracker->pin() : nullptr} {}
+					pinned(const pinned& copy) = delete;
+					pinned& operator=(const pinned& copy) = delete;
+					~pinned() noexcept { if (tracker) { tracker->unpin(); } }
+
+					T& operator* () const noexcept { return *tracked; }
+					T* operator->() const noexcept { return tracked; }
+					T* get()        const noexcept { return tracked; }
+					explicit operator bool() const noexcept { return tracked; }
+
+				private:
+					_::tracker_base<tracker_type, Policy>* tracker;
+					T* tracked;
+				};
+
+			// Empty if uninitialized or if the tracked object was destroyed.
+			pinned pin() const noexcept requires Policy::concurrent { return pinned{tracker.get()}; }
+
 		private:
-			using tracker_type = std::conditional_t<std::is_base_of_v<trackable, T>, trackable, T>;
-			std::shared_ptr<_::tracker_t<tracker_type>> tracker{nullptr};
+			_::tracker_ptr<tracker_type, Policy> tracker{nullptr};
+
+			//containers which keep trackers for their elements
+			tracking_ptr(const _::tracker_ptr<tracker_type, Policy>& tracker) : tracker{tracker} {}
+
+			static const _::tracker_ptr<tracker_type, Policy>& tracker_of(T& tracked) { return static_cast<updater_type&>(tracked).tracker_for(std::addressof(static_cast<tracker_type&>(tracked))); }
+			static const _::tracker_ptr<tracker_type, Policy>& tracker_of(trackable_wrapper<T, Policy>& tracked) { return static_cast<updater_type&>(tracked).tracker_for(std::addressof(tracked.element)); }
 
 			void check_initialized() const
 				{
@@ -179,4 +466,4 @@ namespace utils
 
 			void check_all() const { check_initialized(); check_has_value(); }
 		};
-	}
\ No newline at end of file
+	}
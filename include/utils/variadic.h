@@ -3,6 +3,7 @@
 #include <memory>
 #include <type_traits>
 #include <tuple>
+#include <utility>
 
 namespace utils
 	{
@@ -17,30 +18,38 @@ namespace utils
 
 	namespace variadic
 		{
-		template <typename Container_T, Container_T search_for, Container_T element, Container_T... rest>
-		struct contains_value
+		// Lookups are single fold expressions or constexpr loops over a bool table, instead of one template instantiation per type.
+		namespace _
 			{
-			constexpr static bool value = search_for == element &&
-				contains_value<Container_T, search_for, rest...>::value;
-			};
+			template <size_t size>
+			constexpr size_t first_true(const bool (&matches)[size]) noexcept
+				{
+				for (size_t i = 0; i < size - 1; i++) { if (matches[i]) { return i; } }
+				return size - 1;
+				}
+			}
 
-		template <typename Container_T, Container_T search_for, Container_T element>
-		struct contains_value<Container_T, search_for, element>
+		template <typename Container_T, Container_T search_for, Container_T... values>
+		struct contains_value
 			{
-			constexpr static bool value = search_for == element;
+			constexpr static bool value = ((search_for == values) || ...);
 			};
 
-		template <typename msg_t, typename Current, typename... R>
+		template <typename msg_t, typename... Types>
 		struct contains_type
 			{
-			constexpr static bool value = std::is_same<msg_t, Current>::value || contains_type<msg_t, R...>::value;
+			constexpr static bool value = (std::is_same_v<msg_t, Types> || ...);
 			};
+		template <typename msg_t, typename... Types>
+		inline constexpr bool contains_type_v{contains_type<msg_t, Types...>::value};
 
-		template <typename msg_t, typename Current>
-		struct contains_type<msg_t, Current>
-			{
-			constexpr static bool value = std::is_same<msg_t, Current>::value;
-			};
+		// Position of the first T in Types, sizeof...(Types) if there's none.
+		template <typename T, typename... Types>
+		inline constexpr size_t index_of{_::first_true({std::is_same_v<T, Types>..., true})};
+
+		// Position of the first type in Types which is T or derives from it, sizeof...(Types) if there's none.
+		template <typename T, typename... Types>
+		inline constexpr size_t index_of_derived{_::first_true({std::is_base_of_v<T, Types>..., true})};
 
 		template <typename Child, typename Parent, typename... R>
 		struct contains_child_of
@@ -54,11 +63,50 @@ namespace utils
 			{
 			constexpr static bool value = std::is_base_of<Parent, Child>::value;
 			};
+
+		// Compile time list of types, for the algorithms below.
+		template <typename... Types>
+		struct type_list
+			{
+			inline static constexpr size_t size{sizeof...(Types)};
+
+			template <typename T>
+			inline static constexpr bool contains{contains_type_v<T, Types...>};
+			template <typename T>
+			inline static constexpr size_t index_of{variadic::index_of<T, Types...>};
+
+			template <size_t index>
+			using at = std::tuple_element_t<index, std::tuple<Types...>>;
+
+			template <template <typename...> class Target>
+			using apply = Target<Types...>;
+			};
+
+		namespace _
+			{
+			// Only used in unevaluated contexts, concatenates lists in a fold expression.
+			template <typename... A, typename... B>
+			type_list<A..., B...> operator+(type_list<A...>, type_list<B...>);
+
+			template <template <typename> class Predicate, typename... Types>
+			auto filter(type_list<Types...>) -> decltype((type_list<>{} + ... + std::conditional_t<Predicate<Types>::value, type_list<Types>, type_list<>>{}));
+
+			template <typename... Types, size_t... indices>
+			auto unique(type_list<Types...>, std::index_sequence<indices...>) -> decltype((type_list<>{} + ... + std::conditional_t<index_of<Types, Types...> == indices, type_list<Types>, type_list<>>{}));
+			}
+
+		// The types of List satisfying Predicate, in order.
+		template <template <typename> class Predicate, typename List>
+		using filter = decltype(_::filter<Predicate>(List{}));
+
+		// List without repetitions, keeping the first occurrence of each type.
+		template <typename List>
+		using unique = decltype(_::unique(List{}, std::make_index_sequence<List::size>{}));
 		}
 
 
 	template <typename T, typename Object>
-	inline constexpr auto contains_child_of_type(Object& object) { return std::is_base_of_v<T, Object::value_type>; }
+	inline constexpr auto contains_child_of_type(Object& object) { return std::is_base_of_v<T, typename Object::value_type>; }
 
 
 	template<typename Container_T>
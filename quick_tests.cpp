@@ -19,5 +19,5 @@ int main()
 	buffer.push(s);
 
 	std::cout << buffer.get<int>() << std::endl;
-	//std::cout << buffer.get<std::string>() << std::endl;
+	std::cout << buffer.get<std::string>() << std::endl;
 	}
\ No newline at end of file